@@ -1,5 +1,5 @@
 #!/bin/sh
 # This script compiles the native extension and then runs the game if compilation succeeds.
-# Pass --optimize to the script to compile with optimizations.
+# Pass --optimize, --release or --pgo to the script to compile with optimizations (see mygame/pre-native.sh).
 
 sh mygame/pre-native.sh "$1" && ./dragonruby
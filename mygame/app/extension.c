@@ -5,12 +5,25 @@
 #include "mruby/value.h"
 #include <assert.h>
 #include <dragonruby.h>
+#include <float.h>
 #include <mruby/array.h>
 #include <mruby/data.h>
 #include <mruby/proc.h>
 #include <mruby/variable.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
 
 // testing box2d includes:
 #include "box2d.h"
@@ -61,6 +74,226 @@ static float raycast_callback(b2ShapeId shape_id, b2Vec2 point, b2Vec2 normal, f
 	return 1.0f; // always returning 1.0f makes the raycast always go full length, i.e. not stop on collisions. There might be better ways to do this
 }
 
+// Opt-in tracing of the native phases (world_step, b2World_Step, event processing, raycasts, body creation...) as Chrome / Perfetto
+// trace events. Events are written to a fixed size ring buffer with a single atomic increment, so recording is cheap and safe from any
+// thread; trace_flush writes the buffer out as trace-event JSON (open it in chrome://tracing or ui.perfetto.dev).
+#define TRACE_CAPACITY (1 << 16) // must be a power of two
+#define TRACE_MAX_NAMES 32		 // names registered from Ruby
+#define TRACE_NAME_LENGTH 32
+
+typedef struct {
+	const char *name;
+	uint64_t ts_us;
+	uint32_t tid;
+	char phase; // 'B'egin, 'E'nd or 'i'nstant
+} trace_event_t;
+
+typedef struct {
+	atomic_bool enabled; // toggled on the main thread, read by the placement workers too
+	atomic_uint_fast64_t head;
+	trace_event_t events[TRACE_CAPACITY];
+	char names[TRACE_MAX_NAMES][TRACE_NAME_LENGTH];
+	int name_count;
+} trace_buffer_t;
+
+static trace_buffer_t trace = {0};
+static _Thread_local uint32_t trace_tid = 1;
+
+// timespec_get is standard C11 and available on every platform DragonRuby ships for
+static uint64_t trace_now_us(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// `name` has to outlive the trace: string literals or names from trace_intern
+static void trace_record(const char *name, char phase) {
+	uint64_t index = atomic_fetch_add_explicit(&trace.head, 1, memory_order_relaxed);
+	trace_event_t *event = &trace.events[index & (TRACE_CAPACITY - 1)];
+	event->name = name;
+	event->ts_us = trace_now_us();
+	event->tid = trace_tid;
+	event->phase = phase;
+}
+
+static inline bool trace_enabled(void) { return atomic_load_explicit(&trace.enabled, memory_order_relaxed); }
+
+static inline const char *trace_begin(const char *name) {
+	if (trace_enabled()) {
+		trace_record(name, 'B');
+	}
+	return name;
+}
+
+static inline void trace_end(const char *const *name) {
+	if (trace_enabled()) {
+		trace_record(*name, 'E');
+	}
+}
+
+// TRACE_SCOPE("name") records a begin event now and the matching end event when the enclosing scope is left
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) const char *TRACE_CONCAT(trace_scope_, __LINE__) __attribute__((cleanup(trace_end))) = trace_begin(name)
+
+// returns a stable copy of a name coming from Ruby; names are only ever added, the table is small
+static const char *trace_intern(const char *name) {
+	for (int i = 0; i < trace.name_count; ++i) {
+		if (strncmp(trace.names[i], name, TRACE_NAME_LENGTH - 1) == 0)
+			return trace.names[i];
+	}
+	if (trace.name_count == TRACE_MAX_NAMES) {
+		return "ruby";
+	}
+	char *copy = trace.names[trace.name_count++];
+	strncpy(copy, name, TRACE_NAME_LENGTH - 1);
+	copy[TRACE_NAME_LENGTH - 1] = '\0';
+	return copy;
+}
+
+// writes `str` as a JSON string; names passed to World#trace_begin may contain quotes, backslashes or control characters
+static void trace_write_json_string(FILE *file, const char *str) {
+	fputc('"', file);
+	for (const unsigned char *c = (const unsigned char *)str; *c; ++c) {
+		if (*c == '"' || *c == '\\') {
+			fputc('\\', file);
+			fputc(*c, file);
+		} else if (*c < 0x20) {
+			fprintf(file, "\\u%04x", *c);
+		} else {
+			fputc(*c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+// writes the buffered events (the newest TRACE_CAPACITY ones) as trace-event JSON, returns false if the file can't be opened
+static bool trace_write_json(const char *path) {
+	FILE *file = fopen(path, "w");
+	if (!file) {
+		return false;
+	}
+
+	uint64_t head = atomic_load(&trace.head);
+	uint64_t first = head > TRACE_CAPACITY ? head - TRACE_CAPACITY : 0;
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for (uint64_t i = first; i < head; ++i) {
+		trace_event_t *event = &trace.events[i & (TRACE_CAPACITY - 1)];
+		fprintf(file, "{\"name\":");
+		trace_write_json_string(file, event->name);
+		fprintf(file, ",\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%u%s}%s\n", event->phase, (unsigned long long)event->ts_us, event->tid,
+				event->phase == 'i' ? ",\"s\":\"g\"" : "", i + 1 < head ? "," : "");
+	}
+	fprintf(file, "]}\n");
+	fclose(file);
+	return true;
+}
+
+// Memory accounting: Box2D allocates through box2d_alloc / box2d_free (installed with b2SetAllocator) and the extension's own
+// allocations go through tracked_malloc / tracked_free, so World#memory_stats can tell which of them keeps growing
+typedef enum {
+	MEM_BOX2D,
+	MEM_WORLD_HANDLES,
+	MEM_BODY_HANDLES,
+	MEM_BODY_CONTEXTS,
+	MEM_BODY_LISTS,
+	MEM_SCRATCH, // per-call temporary buffers, should always be back to 0 between calls
+	MEM_CATEGORY_COUNT
+} mem_category;
+
+static const char *MEM_CATEGORY_NAMES[MEM_CATEGORY_COUNT] = {"box2d", "world_handles", "body_handles", "body_contexts", "body_lists", "scratch"};
+
+// atomic because Box2D may allocate from its worker tasks
+typedef struct {
+	atomic_llong bytes[MEM_CATEGORY_COUNT];
+	atomic_llong count[MEM_CATEGORY_COUNT];
+	atomic_llong allocations[MEM_CATEGORY_COUNT]; // total since startup, for allocations per call in benchmarks
+	atomic_llong current;
+	atomic_llong peak;
+} mem_stats_t;
+
+static mem_stats_t mem_stats = {0};
+
+static void mem_track(mem_category category, long long bytes, long long count) {
+	atomic_fetch_add(&mem_stats.bytes[category], bytes);
+	atomic_fetch_add(&mem_stats.count[category], count);
+	if (count > 0) {
+		atomic_fetch_add(&mem_stats.allocations[category], count);
+	}
+	long long current = atomic_fetch_add(&mem_stats.current, bytes) + bytes;
+	long long peak = atomic_load(&mem_stats.peak);
+	while (current > peak && !atomic_compare_exchange_weak(&mem_stats.peak, &peak, current)) {
+	}
+}
+
+// header in front of every tracked mruby allocation, padded so the returned memory keeps malloc's alignment
+typedef union {
+	struct {
+		size_t size;
+		mem_category category;
+	} info;
+	max_align_t align;
+} mem_header;
+
+static void *tracked_malloc(mrb_state *mrb, size_t size, mem_category category) {
+	mem_header *header = drb_api->mrb_malloc(mrb, sizeof(mem_header) + size);
+	header->info.size = size;
+	header->info.category = category;
+	mem_track(category, (long long)size, 1);
+	return header + 1;
+}
+
+static void *tracked_realloc(mrb_state *mrb, void *p, size_t size, mem_category category) {
+	if (!p) {
+		return tracked_malloc(mrb, size, category);
+	}
+	mem_header *header = (mem_header *)p - 1;
+	mem_track(header->info.category, -(long long)header->info.size, -1);
+	header = drb_api->mrb_realloc(mrb, header, sizeof(mem_header) + size);
+	header->info.size = size;
+	header->info.category = category;
+	mem_track(category, (long long)size, 1);
+	return header + 1;
+}
+
+static void tracked_free(mrb_state *mrb, void *p) {
+	if (!p) {
+		return;
+	}
+	mem_header *header = (mem_header *)p - 1;
+	mem_track(header->info.category, -(long long)header->info.size, -1);
+	drb_api->mrb_free(mrb, header);
+}
+
+// Box2D asks for aligned blocks (B2_ALIGNMENT) and can allocate outside of any mruby call, so it uses the C allocator; the original
+// pointer and size are stored right before the aligned block
+typedef struct {
+	void *raw;
+	size_t size;
+} box2d_alloc_header;
+
+static void *box2d_alloc(unsigned int size, int alignment) {
+	char *raw = malloc(size + alignment + sizeof(box2d_alloc_header));
+	if (!raw) {
+		return NULL;
+	}
+	uintptr_t aligned = ((uintptr_t)raw + sizeof(box2d_alloc_header) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	box2d_alloc_header *header = (box2d_alloc_header *)aligned - 1;
+	header->raw = raw;
+	header->size = size;
+	mem_track(MEM_BOX2D, size, 1);
+	return (void *)aligned;
+}
+
+static void box2d_free(void *mem) {
+	if (!mem) {
+		return;
+	}
+	box2d_alloc_header *header = (box2d_alloc_header *)mem - 1;
+	mem_track(MEM_BOX2D, -(long long)header->size, -1);
+	free(header->raw);
+}
+
 // Collision filter categories
 #define TETROMINO_BIT 0x0001
 #define SENSOR_BIT 0x0002
@@ -74,16 +307,129 @@ typedef struct {
 	body_type_t type;
 	int contact_count;
 	bool collided;
+	int tetromino_kind;	  // -1 unless the body was built from a tetromino template
+	float square_size_px; // cell size of the tetromino template
+	float settled_time;	  // seconds the body has been asleep or (nearly) still, see update_frozen_bodies
+	bool frozen;		  // dynamic body temporarily converted to a static one
+	// jitter detection state, see update_jittering_bodies
+	float prev_vy;
+	float prev_angular_velocity;
+	float flip_rate;   // moving average of velocity sign flips per step
+	float jitter_time; // seconds of sustained jitter
+	bool damped;	   // extra damping applied, base_* hold the values to restore
+	float base_linear_damping;
+	float base_angular_damping;
+	// active piece controller, see update_body_controllers
+	bool controlled;
+	b2Vec2 target_velocity; // m/s
+	float target_spin;		// rad/s
+	bool hold_angle;		// steer towards target_angle instead of spinning at target_spin
+	float target_angle;		// radians
+	b2BodyId control_anchor; // kinematic body the motor joint pulls the controlled body towards
+	b2JointId control_joint;
+	// active region state, see update_active_region
+	bool region_disabled; // removed from the simulation with b2Body_Disable
+	bool region_locked;	  // frozen as part of the floor band below the active region
+	bool in_region;		  // overlaps the active region, i.e. is visible
+	float region_top;	  // top of the body's AABB (meters) when it was disabled
+	mrb_int tag;		  // free for game use, set by create_bodies
 } body_user_context;
 
+// growable list of body ids, allocated through the (tracked) mruby allocator
+typedef struct {
+	b2BodyId *ids;
+	int count;
+	int capacity;
+} body_id_list;
+
+static void body_id_list_push(mrb_state *mrb, body_id_list *list, b2BodyId id) {
+	if (list->count == list->capacity) {
+		list->capacity = list->capacity ? list->capacity * 2 : 32;
+		list->ids = tracked_realloc(mrb, list->ids, sizeof(b2BodyId) * list->capacity, MEM_BODY_LISTS);
+	}
+	list->ids[list->count++] = id;
+}
+
+static bool body_id_list_contains(const body_id_list *list, b2BodyId id) {
+	for (int i = 0; i < list->count; ++i) {
+		if (B2_ID_EQUALS(list->ids[i], id))
+			return true;
+	}
+	return false;
+}
+
+static void body_id_list_free(mrb_state *mrb, body_id_list *list) {
+	if (list->ids) {
+		tracked_free(mrb, list->ids);
+	}
+	*list = (body_id_list){0};
+}
+
+static void body_id_list_remove(body_id_list *list, b2BodyId id) {
+	for (int i = 0; i < list->count; ++i) {
+		if (B2_ID_EQUALS(list->ids[i], id)) {
+			list->ids[i] = list->ids[--list->count];
+			return;
+		}
+	}
+}
+
+// drops the bodies of one world from `list`, freeing it once it's empty
+static void body_id_list_remove_world(mrb_state *mrb, body_id_list *list, b2WorldId world_id) {
+	int kept = 0;
+	for (int i = 0; i < list->count; ++i) {
+		if (list->ids[i].world0 != world_id.index1 - 1) {
+			list->ids[kept++] = list->ids[i];
+		}
+	}
+	list->count = kept;
+	if (kept == 0) {
+		body_id_list_free(mrb, list);
+	}
+}
+
+// every dynamic body created through create_body, so per-step passes (freezing settled stacks etc.) don't need Box2D to enumerate them
+static body_id_list tracked_bodies;
+// bodies with an active controller (Body#control), see update_body_controllers
+static body_id_list controlled_bodies;
+// the tracked bodies overlapping the active region (all of them without a region), rebuilt every step by update_active_region
+static body_id_list region_bodies;
+
+// destroys the kinematic anchor of a controlled body, which also destroys its motor joint
+static void destroy_control_anchor(body_user_context *buc) {
+	if (B2_IS_NON_NULL(buc->control_anchor) && b2Body_IsValid(buc->control_anchor)) {
+		b2DestroyBody(buc->control_anchor);
+	}
+	buc->control_anchor = b2_nullBodyId;
+	buc->control_joint = b2_nullJointId;
+}
+
+static void untrack_body(b2BodyId id) {
+	body_id_list_remove(&tracked_bodies, id);
+	body_id_list_remove(&controlled_bodies, id);
+	body_id_list_remove(&region_bodies, id);
+}
+
+// drops the bodies of a destroyed world; a restarted level creates its new world before the old one gets garbage collected
+static void untrack_world_bodies(mrb_state *mrb, b2WorldId world_id) {
+	body_id_list_remove_world(mrb, &tracked_bodies, world_id);
+	body_id_list_remove_world(mrb, &controlled_bodies, world_id);
+	body_id_list_remove_world(mrb, &region_bodies, world_id);
+}
+
+// defined with the placement search below; has to run before a world is created or destroyed
+static void cancel_placement_search(mrb_state *mrb);
+
 // TODO: Do we also need to free all bodies / shapes to avoid leaks on ruby-held objects?
 static void b2WorldId_free(mrb_state *mrb, void *p) {
 	printf("[CExt] -- INFO: freeing Box2D world");
 	b2WorldId *id = (b2WorldId *)p;
+	cancel_placement_search(mrb);
+	untrack_world_bodies(mrb, *id);
 	b2DestroyWorld(*id);
 	*id = b2_nullWorldId;
 	main_world_ptr = NULL;
-	drb_api->mrb_free(mrb, p);
+	tracked_free(mrb, p);
 }
 
 static const struct mrb_data_type b2WorldId_type = {
@@ -103,10 +449,12 @@ static void b2BodyId_free(mrb_state *mrb, void *p) {
 	}
 	body_user_context *buc = (body_user_context *)b2Body_GetUserData(*bodyId);
 	if (buc) {
-		drb_api->mrb_free(mrb, buc);
+		destroy_control_anchor(buc);
+		tracked_free(mrb, buc);
 	}
+	untrack_body(*bodyId);
 	b2DestroyBody(*(b2BodyId *)p);
-	drb_api->mrb_free(mrb, p);
+	tracked_free(mrb, p);
 }
 
 static const struct mrb_data_type b2BodyId_type = {
@@ -119,11 +467,12 @@ static b2Vec2 pixels_to_meters(float x, float y) { return (b2Vec2){x / PIXELS_PE
 static b2Vec2 meters_to_pixels(float x, float y) { return (b2Vec2){x * PIXELS_PER_METER, y * PIXELS_PER_METER}; }
 
 static mrb_value world_initialize(mrb_state *mrb, mrb_value self) {
+	cancel_placement_search(mrb);
 	mainWorldDef = b2DefaultWorldDef();
 	b2WorldId worldId = b2CreateWorld(&mainWorldDef);
 	b2World_SetGravity(worldId, (b2Vec2){0.0f, -9.8f});
 
-	b2WorldId *worldId_ptr = (b2WorldId *)drb_api->mrb_malloc(mrb, sizeof(b2WorldId));
+	b2WorldId *worldId_ptr = (b2WorldId *)tracked_malloc(mrb, sizeof(b2WorldId), MEM_WORLD_HANDLES);
 	*worldId_ptr = worldId;
 
 	mrb_data_init(self, worldId_ptr, &b2WorldId_type);
@@ -131,7 +480,44 @@ static mrb_value world_initialize(mrb_state *mrb, mrb_value self) {
 	return self;
 }
 
+// FFI::Box2D::Body, looked up once when the extension is registered
+static struct RClass *body_class = NULL;
+
+// creates a body with a fresh user context and its Ruby object; dynamic bodies are added to tracked_bodies
+static mrb_value create_body_object(mrb_state *mrb, b2WorldId world_id, b2BodyDef *bodyDef) {
+	mrb_value body_obj = drb_api->mrb_obj_new(mrb, body_class, 0, NULL);
+
+	body_user_context *holder = (body_user_context *)tracked_malloc(mrb, sizeof(body_user_context), MEM_BODY_CONTEXTS);
+	*holder = (body_user_context){0};
+	holder->body_obj = body_obj;
+	holder->type = BODY_TYPE_REGULAR;
+	holder->tetromino_kind = -1;
+	holder->in_region = true;
+	bodyDef->userData = holder;
+
+	b2BodyId bodyId = b2CreateBody(world_id, bodyDef);
+	if (bodyDef->type == b2_dynamicBody) {
+		body_id_list_push(mrb, &tracked_bodies, bodyId);
+		// new bodies start out in the region (split pieces must render before the next step)
+		body_id_list_push(mrb, &region_bodies, bodyId);
+	}
+
+	b2BodyId *bodyId_ptr = (b2BodyId *)tracked_malloc(mrb, sizeof(b2BodyId), MEM_BODY_HANDLES);
+	*bodyId_ptr = bodyId;
+	mrb_data_init(body_obj, bodyId_ptr, &b2BodyId_type);
+	return body_obj;
+}
+
+static b2BodyDef dynamic_body_def(void) {
+	b2BodyDef bodyDef = b2DefaultBodyDef();
+	bodyDef.type = b2_dynamicBody;
+	bodyDef.linearDamping = 0.2f;
+	bodyDef.angularDamping = 0.6f;
+	return bodyDef;
+}
+
 static mrb_value world_create_body(mrb_state *mrb, mrb_value self) {
+	TRACE_SCOPE("create_body");
 	b2WorldId *worldId = DATA_PTR(self);
 	// printf("[CExt] -- INFO: Creating Body...\n");
 	mrb_value type_str;
@@ -140,45 +526,18 @@ static mrb_value world_create_body(mrb_state *mrb, mrb_value self) {
 	mrb_float vx = 0.0, vy = 0.0, av = 0.0;
 	drb_api->mrb_get_args(mrb, "Sff|bfff", &type_str, &x, &y, &allow_sleep, &vx, &vy, &av);
 
-	struct RClass *module = drb_api->mrb_module_get(mrb, "FFI");
-	module = drb_api->mrb_module_get_under(mrb, module, "Box2D");
-	struct RClass *body_class = drb_api->mrb_class_get_under(mrb, module, "Body");
-	mrb_value body_obj = drb_api->mrb_obj_new(mrb, body_class, 0, NULL);
-
-	drb_api->mrb_iv_set(mrb, body_obj, drb_api->mrb_intern_lit(mrb, "@contacts"), drb_api->mrb_ary_new(mrb));
-
 	b2BodyDef bodyDef = b2DefaultBodyDef();
-	bodyDef.position = pixels_to_meters(x, y);
-	b2Vec2 linear_vel_meters = pixels_to_meters(vx, vy);
-	bodyDef.linearVelocity = linear_vel_meters;
-	bodyDef.angularVelocity = av * DEGTORAD;
-
-	body_user_context *holder = (body_user_context *)drb_api->mrb_malloc(mrb, sizeof(body_user_context));
-	holder->body_obj = body_obj;
-	holder->type = BODY_TYPE_REGULAR;
-	holder->contact_count = 0;
-	holder->collided = false;
-	bodyDef.userData = holder;
-
-	b2BodyType type = b2_staticBody;
 	if (strcmp(drb_api->mrb_str_to_cstr(mrb, type_str), "dynamic") == 0) {
-		type = b2_dynamicBody;
-		bodyDef.linearDamping = 0.2f;
-		bodyDef.angularDamping = 0.6f;
+		bodyDef = dynamic_body_def();
 		bodyDef.enableSleep = allow_sleep;
 	} else if (strcmp(drb_api->mrb_str_to_cstr(mrb, type_str), "kinematic") == 0) {
-		type = b2_kinematicBody;
+		bodyDef.type = b2_kinematicBody;
 	}
+	bodyDef.position = pixels_to_meters(x, y);
+	bodyDef.linearVelocity = pixels_to_meters(vx, vy);
+	bodyDef.angularVelocity = av * DEGTORAD;
 
-	bodyDef.type = type;
-	b2BodyId bodyId = b2CreateBody(*worldId, &bodyDef);
-
-	b2BodyId *bodyId_ptr = (b2BodyId *)drb_api->mrb_malloc(mrb, sizeof(b2BodyId));
-	*bodyId_ptr = bodyId;
-
-	mrb_data_init(body_obj, bodyId_ptr, &b2BodyId_type);
-
-	return body_obj;
+	return create_body_object(mrb, *worldId, &bodyDef);
 }
 
 static mrb_value body_create_sensor_box(mrb_state *mrb, mrb_value self) {
@@ -235,7 +594,7 @@ static mrb_value body_create_box_shape(mrb_state *mrb, mrb_value self) {
 
 // Helper function to create an offset polygon for a box using b2MakeBox and translation
 // This is used to easily create the tetriminos
-static void create_offset_box_fixture(b2BodyId bodyId, const b2ShapeDef *shapeDef, float box_width_px, float box_height_px, float offset_x_px, float offset_y_px) {
+static b2Polygon make_offset_box_polygon(float box_width_px, float box_height_px, float offset_x_px, float offset_y_px) {
 	float hw_m = (box_width_px / PIXELS_PER_METER) / 2.0f;
 	float hh_m = (box_height_px / PIXELS_PER_METER) / 2.0f;
 	float offset_x_m = offset_x_px / PIXELS_PER_METER;
@@ -247,209 +606,285 @@ static void create_offset_box_fixture(b2BodyId bodyId, const b2ShapeDef *shapeDe
 		poly.vertices[i] = b2Add(poly.vertices[i], offset);
 	}
 	poly.centroid = b2Add(poly.centroid, offset);
-
-	b2CreatePolygonShape(bodyId, shapeDef, &poly);
+	return poly;
 }
 
-// T-shape. Origin is the center of the 3-block horizontal bar.
-//   #
-// # # #
-static mrb_value body_create_t_shape(mrb_state *mrb, mrb_value self) {
-	b2BodyId *bodyId = DATA_PTR(self);
-	mrb_float square_size_px, density;
-	mrb_float friction = 0.5f;
-	mrb_float restitution = 0.1f;
-	drb_api->mrb_get_args(mrb, "ff|ff", &square_size_px, &density, &friction, &restitution);
+// Tetromino templates: the cell centers of each piece in units of the square size, relative to the body origin. These are shared by the
+// shape constructors and the placement queries (can_place / predict_landing) so both always agree on the geometry.
+typedef enum {
+	TETROMINO_T,
+	TETROMINO_O,
+	TETROMINO_L,
+	TETROMINO_J,
+	TETROMINO_I,
+	TETROMINO_S,
+	TETROMINO_Z,
+	TETROMINO_KIND_COUNT
+} tetromino_kind;
+
+#define TETROMINO_CELL_COUNT 4
+
+static const char *TETROMINO_NAMES[TETROMINO_KIND_COUNT] = {"t", "o", "l", "j", "i", "s", "z"};
+
+static const b2Vec2 TETROMINO_CELLS[TETROMINO_KIND_COUNT][TETROMINO_CELL_COUNT] = {
+	// T-shape. Origin is the center of the 3-block horizontal bar.
+	//   #
+	// # # #
+	[TETROMINO_T] = {{0.0f, 0.0f}, {-1.0f, 0.0f}, {1.0f, 0.0f}, {0.0f, 1.0f}},
+	// O-shape. Origin is the center of the 2x2 block.
+	[TETROMINO_O] = {{-0.5f, -0.5f}, {0.5f, -0.5f}, {-0.5f, 0.5f}, {0.5f, 0.5f}},
+	// L-shape. Origin is the center of the 3-block segment.
+	//     #
+	// # # #
+	[TETROMINO_L] = {{-1.0f, 0.0f}, {0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}},
+	// J-shape (mirrored L). Origin is the center of the 3-block segment.
+	// #
+	// # # #
+	[TETROMINO_J] = {{-1.0f, 0.0f}, {1.0f, 0.0f}, {-1.0f, 1.0f}, {0.0f, 0.0f}},
+	// I-shape. Origin is the center of the 4-block segment.
+	//   #
+	//   #
+	//   #
+	//   #
+	[TETROMINO_I] = {{0.0f, -1.5f}, {0.0f, 1.5f}, {0.0f, 0.5f}, {0.0f, -0.5f}},
+	// S-shape. Origin is at the center of the shape
+	//   # #
+	// # #
+	[TETROMINO_S] = {{0.0f, 0.0f}, {-1.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 1.0f}},
+	// Z-shape (mirrored S). Origin is at the center of the shape
+	// # #
+	//   # #
+	[TETROMINO_Z] = {{0.0f, 0.0f}, {1.0f, 0.0f}, {0.0f, 1.0f}, {-1.0f, 1.0f}},
+};
 
-	b2ShapeDef shapeDef = b2DefaultShapeDef();
-	shapeDef.density = density;
-	shapeDef.material.friction = friction;
-	shapeDef.material.restitution = restitution;
-	shapeDef.enableContactEvents = true;
-	shapeDef.enableSensorEvents = true;
-	shapeDef.filter.categoryBits = TETROMINO_BIT;
-	shapeDef.filter.maskBits = GROUND_BIT | SENSOR_BIT | TETROMINO_BIT;
+// Minimal convex decomposition of each template: collision proxies given as bitmasks of the cells they cover (each mask forms a
+// rectangle). Colliding with these instead of one box per cell removes the internal edges between cells and cuts shape, contact pair and
+// constraint counts for the whole stack. Logical cells stay addressable through the cell mask stored as each shape's user data.
+#define TETROMINO_MAX_PROXIES 2
+
+static const uint8_t TETROMINO_PROXIES[TETROMINO_KIND_COUNT][TETROMINO_MAX_PROXIES] = {
+	[TETROMINO_T] = {0x7, 0x8}, // horizontal bar + top cell
+	[TETROMINO_O] = {0xF, 0x0},
+	[TETROMINO_L] = {0x7, 0x8},
+	[TETROMINO_J] = {0xB, 0x4},
+	[TETROMINO_I] = {0xF, 0x0},
+	[TETROMINO_S] = {0x3, 0xC}, // bottom pair + top pair
+	[TETROMINO_Z] = {0x3, 0xC},
+};
 
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, 0, 0);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, -square_size_px, 0);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, square_size_px, 0);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, 0, square_size_px);
+// shapes store the mask of the template cells they cover in their user data; 0 for shapes that aren't made of tetromino cells
+static inline uint8_t shape_cell_mask(b2ShapeId shape_id) { return (uint8_t)(uintptr_t)b2Shape_GetUserData(shape_id); }
 
-	return mrb_nil_value();
+static inline int cell_mask_count(uint8_t mask) {
+	int count = 0;
+	for (; mask; mask &= mask - 1)
+		count++;
+	return count;
 }
 
-static mrb_value body_create_box_shape_2x2(mrb_state *mrb, mrb_value self) {
-	b2BodyId *bodyId = DATA_PTR(self);
-	mrb_float square_size_px, density;
-	mrb_float friction = 0.5f;
-	mrb_float restitution = 0.1f;
-	drb_api->mrb_get_args(mrb, "ff|ff", &square_size_px, &density, &friction, &restitution);
-
-	b2ShapeDef shapeDef;
-	shapeDef = b2DefaultShapeDef();
-	shapeDef.density = density;
-	shapeDef.material.friction = friction;
-	shapeDef.material.restitution = restitution;
-	shapeDef.enableContactEvents = true;
-	shapeDef.enableSensorEvents = true;
-	shapeDef.filter.categoryBits = TETROMINO_BIT;
-	shapeDef.filter.maskBits = GROUND_BIT | SENSOR_BIT | TETROMINO_BIT;
-
-	float s_half = square_size_px / 2.0f;
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, -s_half, -s_half);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, s_half, -s_half);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, -s_half, s_half);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, s_half, s_half);
+// returns the tetromino kind for a (case sensitive) name like "t" or "o", -1 if unknown
+static int tetromino_kind_from_name(const char *name) {
+	for (int i = 0; i < TETROMINO_KIND_COUNT; ++i) {
+		if (strcmp(name, TETROMINO_NAMES[i]) == 0)
+			return i;
+	}
+	return -1;
+}
 
-	return mrb_nil_value();
+// body-local box covering the tetromino cells in `mask`; `inset_px` shrinks the box on every side (used by queries to ignore mere touching)
+static b2Polygon tetromino_mask_polygon(tetromino_kind kind, uint8_t mask, float square_size_px, float inset_px) {
+	b2Vec2 min_c = {INFINITY, INFINITY};
+	b2Vec2 max_c = {-INFINITY, -INFINITY};
+	for (int i = 0; i < TETROMINO_CELL_COUNT; ++i) {
+		if (!(mask & (1u << i)))
+			continue;
+		b2Vec2 c = TETROMINO_CELLS[kind][i];
+		min_c = (b2Vec2){fminf(min_c.x, c.x), fminf(min_c.y, c.y)};
+		max_c = (b2Vec2){fmaxf(max_c.x, c.x), fmaxf(max_c.y, c.y)};
+	}
+	float w_px = (max_c.x - min_c.x + 1.0f) * square_size_px - 2.0f * inset_px;
+	float h_px = (max_c.y - min_c.y + 1.0f) * square_size_px - 2.0f * inset_px;
+	return make_offset_box_polygon(w_px, h_px, (min_c.x + max_c.x) * 0.5f * square_size_px, (min_c.y + max_c.y) * 0.5f * square_size_px);
 }
 
-// L-shape. Origin is the center of the 3-block segment.
-//   #
-//   #
-//   ##
-static mrb_value body_create_l_shape(mrb_state *mrb, mrb_value self) {
-	b2BodyId *bodyId = DATA_PTR(self);
-	mrb_float square_size_px, density;
-	mrb_float friction = 0.5f;
-	mrb_float restitution = 0.1f;
-	drb_api->mrb_get_args(mrb, "ff|ff", &square_size_px, &density, &friction, &restitution);
+// body-local center of a tetromino cell in meters
+static b2Vec2 tetromino_cell_center(tetromino_kind kind, int cell, float square_size_px) {
+	return b2MulSV(square_size_px / PIXELS_PER_METER, TETROMINO_CELLS[kind][cell]);
+}
 
+static b2ShapeDef tetromino_shape_def(float density, float friction, float restitution) {
 	b2ShapeDef shapeDef = b2DefaultShapeDef();
 	shapeDef.density = density;
 	shapeDef.material.friction = friction;
 	shapeDef.material.restitution = restitution;
 	shapeDef.enableContactEvents = true;
 	shapeDef.enableSensorEvents = true;
+	shapeDef.enableHitEvents = true; // used to thaw frozen stacks on hard impacts
 	shapeDef.filter.categoryBits = TETROMINO_BIT;
 	shapeDef.filter.maskBits = GROUND_BIT | SENSOR_BIT | TETROMINO_BIT;
+	return shapeDef;
+}
 
-	// Horizontal bar
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, -square_size_px, 0);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, 0, 0);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, square_size_px, 0);
+static void create_tetromino_mask_shape(b2BodyId bodyId, b2ShapeDef *shapeDef, tetromino_kind kind, uint8_t mask, float square_size_px) {
+	b2Polygon poly = tetromino_mask_polygon(kind, mask, square_size_px, 0.0f);
+	shapeDef->userData = (void *)(uintptr_t)mask;
+	b2CreatePolygonShape(bodyId, shapeDef, &poly);
+}
+
+// builds the body's collision from the template: one box per cell, or the minimal convex proxies when `merge_cells` is set
+static void create_tetromino_shapes(b2BodyId bodyId, tetromino_kind kind, float square_size_px, float density, float friction,
+									float restitution, bool merge_cells) {
+	body_user_context *buc = (body_user_context *)b2Body_GetUserData(bodyId);
+	if (buc) {
+		buc->tetromino_kind = kind;
+		buc->square_size_px = square_size_px;
+	}
 
-	// Vertical bar
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, square_size_px, square_size_px);
-	// create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, square_size_px, 2 * square_size_px);
+	b2ShapeDef shapeDef = tetromino_shape_def(density, friction, restitution);
+	if (merge_cells) {
+		for (int i = 0; i < TETROMINO_MAX_PROXIES && TETROMINO_PROXIES[kind][i]; ++i) {
+			create_tetromino_mask_shape(bodyId, &shapeDef, kind, TETROMINO_PROXIES[kind][i], square_size_px);
+		}
+	} else {
+		for (int i = 0; i < TETROMINO_CELL_COUNT; ++i) {
+			create_tetromino_mask_shape(bodyId, &shapeDef, kind, (uint8_t)(1u << i), square_size_px);
+		}
+	}
+}
 
-	return mrb_nil_value();
+// Removes the cells in `removed_mask` from a (possibly merged) tetromino shape. The surviving cells of the shape get a box each so the body
+// keeps colliding correctly until it is split. The body mass is not updated, see finish_line_clears.
+static void remove_shape_cells(b2ShapeId shape_id, uint8_t removed_mask) {
+	uint8_t mask = shape_cell_mask(shape_id);
+	uint8_t surviving = mask & (uint8_t)~removed_mask;
+	b2BodyId body_id = b2Shape_GetBody(shape_id);
+	body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+
+	if (surviving && buc && buc->tetromino_kind >= 0) {
+		b2ShapeDef shapeDef = tetromino_shape_def(b2Shape_GetDensity(shape_id), b2Shape_GetFriction(shape_id), b2Shape_GetRestitution(shape_id));
+		shapeDef.updateBodyMass = false;
+		for (int i = 0; i < TETROMINO_CELL_COUNT; ++i) {
+			if (surviving & (1u << i)) {
+				create_tetromino_mask_shape(body_id, &shapeDef, buc->tetromino_kind, (uint8_t)(1u << i), buc->square_size_px);
+			}
+		}
+	}
+	b2DestroyShape(shape_id, false);
 }
 
-// J-shape (mirrored L). Origin is the center of the 3-block segment.
-//   #
-//   #
-//  ##
-static mrb_value body_create_j_shape(mrb_state *mrb, mrb_value self) {
+// shared implementation of the Ruby-facing create_*_shape(square_size, density, friction = 0.5, restitution = 0.1, merge_cells = false)
+// methods
+static mrb_value body_create_tetromino_shape(mrb_state *mrb, mrb_value self, tetromino_kind kind) {
+	TRACE_SCOPE("create_tetromino_shape");
 	b2BodyId *bodyId = DATA_PTR(self);
 	mrb_float square_size_px, density;
 	mrb_float friction = 0.5f;
 	mrb_float restitution = 0.1f;
-	drb_api->mrb_get_args(mrb, "ff|ff", &square_size_px, &density, &friction, &restitution);
-
-	b2ShapeDef shapeDef = b2DefaultShapeDef();
-	shapeDef.density = density;
-	shapeDef.material.friction = friction;
-	shapeDef.material.restitution = restitution;
-	shapeDef.enableContactEvents = true;
-	shapeDef.enableSensorEvents = true;
-	shapeDef.filter.categoryBits = TETROMINO_BIT;
-	shapeDef.filter.maskBits = GROUND_BIT | SENSOR_BIT | TETROMINO_BIT;
+	mrb_bool merge_cells = false;
+	drb_api->mrb_get_args(mrb, "ff|ffb", &square_size_px, &density, &friction, &restitution, &merge_cells);
 
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, -square_size_px, 0);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, square_size_px, 0);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, -square_size_px, square_size_px);
-
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, 0, 0);
+	create_tetromino_shapes(*bodyId, kind, square_size_px, density, friction, restitution, merge_cells);
 
 	return mrb_nil_value();
 }
 
-// S-shape. Origin is at the center of the shape
-//    #
-//  ##
-//  #
-static mrb_value body_create_s_shape(mrb_state *mrb, mrb_value self) {
-	b2BodyId *bodyId = DATA_PTR(self);
-	mrb_float square_size_px, density;
-	mrb_float friction = 0.5f;
-	mrb_float restitution = 0.1f;
-	drb_api->mrb_get_args(mrb, "ff|ff", &square_size_px, &density, &friction, &restitution);
-
-	b2ShapeDef shapeDef = b2DefaultShapeDef();
-	shapeDef.density = density;
-	shapeDef.material.friction = friction;
-	shapeDef.material.restitution = restitution;
-	shapeDef.enableContactEvents = true;
-	shapeDef.enableSensorEvents = true;
-	shapeDef.filter.categoryBits = TETROMINO_BIT;
-	shapeDef.filter.maskBits = GROUND_BIT | SENSOR_BIT | TETROMINO_BIT;
+static mrb_value body_create_t_shape(mrb_state *mrb, mrb_value self) { return body_create_tetromino_shape(mrb, self, TETROMINO_T); }
 
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, 0, 0);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, -square_size_px, 0);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, 0, square_size_px);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, square_size_px, square_size_px);
+static mrb_value body_create_box_shape_2x2(mrb_state *mrb, mrb_value self) { return body_create_tetromino_shape(mrb, self, TETROMINO_O); }
 
-	return mrb_nil_value();
-}
+static mrb_value body_create_l_shape(mrb_state *mrb, mrb_value self) { return body_create_tetromino_shape(mrb, self, TETROMINO_L); }
 
-// Z-shape (mirrored S). Origin is at the center of the shape
-//  #
-//  ##
-//   #
-static mrb_value body_create_z_shape(mrb_state *mrb, mrb_value self) {
-	b2BodyId *bodyId = DATA_PTR(self);
-	mrb_float square_size_px, density;
-	mrb_float friction = 0.5f;
-	mrb_float restitution = 0.1f;
-	drb_api->mrb_get_args(mrb, "ff|ff", &square_size_px, &density, &friction, &restitution);
+static mrb_value body_create_j_shape(mrb_state *mrb, mrb_value self) { return body_create_tetromino_shape(mrb, self, TETROMINO_J); }
 
-	b2ShapeDef shapeDef = b2DefaultShapeDef();
-	shapeDef.density = density;
-	shapeDef.material.friction = friction;
-	shapeDef.material.restitution = restitution;
-	shapeDef.enableContactEvents = true;
-	shapeDef.enableSensorEvents = true;
-	shapeDef.filter.categoryBits = TETROMINO_BIT;
-	shapeDef.filter.maskBits = GROUND_BIT | SENSOR_BIT | TETROMINO_BIT;
+static mrb_value body_create_i_shape(mrb_state *mrb, mrb_value self) { return body_create_tetromino_shape(mrb, self, TETROMINO_I); }
 
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, 0, 0);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, square_size_px, 0);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, 0, square_size_px);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, -square_size_px, square_size_px);
+static mrb_value body_create_s_shape(mrb_state *mrb, mrb_value self) { return body_create_tetromino_shape(mrb, self, TETROMINO_S); }
 
-	return mrb_nil_value();
-}
+static mrb_value body_create_z_shape(mrb_state *mrb, mrb_value self) { return body_create_tetromino_shape(mrb, self, TETROMINO_Z); }
 
-// I-shape. Origin is the center of the 4-block segment.
-//   #
-//   #
-//   #
-//   #
-static mrb_value body_create_i_shape(mrb_state *mrb, mrb_value self) {
-	b2BodyId *bodyId = DATA_PTR(self);
-	mrb_float square_size_px, density;
-	mrb_float friction = 0.5f;
-	mrb_float restitution = 0.1f;
-	drb_api->mrb_get_args(mrb, "ff|ff", &square_size_px, &density, &friction, &restitution);
+#define PACKED_BODY_STRIDE 8
 
-	b2ShapeDef shapeDef = b2DefaultShapeDef();
+// integer field of a packed record; Integers are read as is so large tags keep every bit, Floats are truncated
+static mrb_int packed_int(mrb_state *mrb, mrb_value value) {
+	return mrb_fixnum_p(value) ? mrb_fixnum(value) : (mrb_int)drb_api->mrb_to_flo(mrb, value);
+}
 
-	shapeDef.density = density;
-	shapeDef.material.friction = friction;
-	shapeDef.material.restitution = restitution;
-	shapeDef.enableContactEvents = true;
-	shapeDef.enableSensorEvents = true;
-	shapeDef.filter.categoryBits = TETROMINO_BIT;
-	shapeDef.filter.maskBits = GROUND_BIT | SENSOR_BIT | TETROMINO_BIT;
+// a Float or an Integer
+static bool is_number(mrb_value value) { return mrb_fixnum_p(value) || mrb_type(value) == MRB_TT_FLOAT; }
 
-	float half = square_size_px / 2.0f;
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, 0, -half - square_size_px);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, 0, half + square_size_px);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, 0, half);
-	create_offset_box_fixture(*bodyId, &shapeDef, square_size_px, square_size_px, 0, -half);
+typedef struct {
+	bool valid; // an array of at least 3 numbers
+	float density, friction, restitution;
+} packed_material;
+
+// create_bodies(packed, square_size, materials, merge_cells = true) - creates a dynamic tetromino body per record of the flat `packed`
+// array [kind, x, y, angle, vx, vy, material, tag, ...] in one call: kind indexes "t o l j i s z", x/y/vx/vy are pixels, angle is degrees,
+// material indexes `materials` ([[density, friction, restitution], ...]) and tag is stored on the body (Body#tag). Returns the bodies in
+// record order, nil if the array isn't made of whole records. Records with an unknown kind or a missing or malformed material are skipped
+// with a warning and leave nil in their slot, so the result always lines up with the records.
+static mrb_value world_create_bodies(mrb_state *mrb, mrb_value self) {
+	TRACE_SCOPE("create_bodies");
+	b2WorldId *worldId = DATA_PTR(self);
+	mrb_value packed, materials;
+	mrb_float square_size_px;
+	mrb_bool merge_cells = true;
+	drb_api->mrb_get_args(mrb, "AfA|b", &packed, &square_size_px, &materials, &merge_cells);
+
+	mrb_int length = RARRAY_LEN(packed);
+	if (length % PACKED_BODY_STRIDE != 0) {
+		printf("[CExt] -- WARNING: create_bodies expects %d values per record, got %d values\n", PACKED_BODY_STRIDE, (int)length);
+		return mrb_nil_value();
+	}
+	mrb_int material_count = RARRAY_LEN(materials);
+	packed_material *material_props = tracked_malloc(mrb, sizeof(packed_material) * (material_count ? material_count : 1), MEM_SCRATCH);
+	for (mrb_int m = 0; m < material_count; ++m) {
+		mrb_value props = drb_api->mrb_ary_entry(materials, m);
+		packed_material *p = &material_props[m];
+		p->valid = mrb_type(props) == MRB_TT_ARRAY && RARRAY_LEN(props) >= 3;
+		for (int i = 0; i < 3 && p->valid; ++i) {
+			p->valid = is_number(drb_api->mrb_ary_entry(props, i));
+		}
+		if (!p->valid) {
+			printf("[CExt] -- WARNING: create_bodies material %d is not [density, friction, restitution]\n", (int)m);
+			continue;
+		}
+		p->density = drb_api->mrb_to_flo(mrb, drb_api->mrb_ary_entry(props, 0));
+		p->friction = drb_api->mrb_to_flo(mrb, drb_api->mrb_ary_entry(props, 1));
+		p->restitution = drb_api->mrb_to_flo(mrb, drb_api->mrb_ary_entry(props, 2));
+	}
 
-	return mrb_nil_value();
+	mrb_value result = drb_api->mrb_ary_new_capa(mrb, length / PACKED_BODY_STRIDE);
+	for (mrb_int r = 0; r < length; r += PACKED_BODY_STRIDE) {
+		// x, y, angle, vx, vy; kind, material and tag are read as integers
+		float v[5];
+		for (int i = 0; i < 5; ++i) {
+			v[i] = drb_api->mrb_to_flo(mrb, drb_api->mrb_ary_entry(packed, r + 1 + i));
+		}
+		mrb_int kind = packed_int(mrb, drb_api->mrb_ary_entry(packed, r));
+		mrb_int material = packed_int(mrb, drb_api->mrb_ary_entry(packed, r + 6));
+		mrb_int tag = packed_int(mrb, drb_api->mrb_ary_entry(packed, r + 7));
+		if (kind < 0 || kind >= TETROMINO_KIND_COUNT || material < 0 || material >= material_count || !material_props[material].valid) {
+			printf("[CExt] -- WARNING: create_bodies skipped record %d (kind %lld, material %lld)\n", (int)(r / PACKED_BODY_STRIDE), (long long)kind,
+				   (long long)material);
+			drb_api->mrb_ary_push(mrb, result, mrb_nil_value());
+			continue;
+		}
+		const packed_material *props = &material_props[material];
+
+		b2BodyDef bodyDef = dynamic_body_def();
+		bodyDef.position = pixels_to_meters(v[0], v[1]);
+		bodyDef.rotation = b2MakeRot(v[2] * DEGTORAD);
+		bodyDef.linearVelocity = pixels_to_meters(v[3], v[4]);
+
+		mrb_value body_obj = create_body_object(mrb, *worldId, &bodyDef);
+		b2BodyId *bodyId = DATA_PTR(body_obj);
+		create_tetromino_shapes(*bodyId, (tetromino_kind)kind, square_size_px, props->density, props->friction, props->restitution,
+								merge_cells);
+		((body_user_context *)b2Body_GetUserData(*bodyId))->tag = tag;
+		drb_api->mrb_ary_push(mrb, result, body_obj);
+	}
+	tracked_free(mrb, material_props);
+	return result;
 }
 
 static mrb_value body_create_chain_shape(mrb_state *mrb, mrb_value self) {
@@ -468,7 +903,7 @@ static mrb_value body_create_chain_shape(mrb_state *mrb, mrb_value self) {
 		return mrb_nil_value();
 	}
 
-	b2Vec2 *points = drb_api->mrb_malloc(mrb, sizeof(b2Vec2) * num_points);
+	b2Vec2 *points = tracked_malloc(mrb, sizeof(b2Vec2) * num_points, MEM_SCRATCH);
 	for (int i = 0; i < num_points; i++) {
 		mrb_value point_hash = drb_api->mrb_ary_entry(points_array, i);
 		mrb_value x_val = drb_api->mrb_hash_get(mrb, point_hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "x")));
@@ -498,7 +933,7 @@ static mrb_value body_create_chain_shape(mrb_state *mrb, mrb_value self) {
 
 	b2CreateChain(*bodyId, &chainDef);
 
-	drb_api->mrb_free(mrb, points);
+	tracked_free(mrb, points);
 
 	return mrb_nil_value();
 }
@@ -517,45 +952,425 @@ static float get_delta_time() {
 	return dt;
 }
 
+// a body moving slower than this (m/s) counts as settled - both for freezing and for the line clear candidate filter
+#define SETTLED_MAX_SPEED 0.01f
+#define SETTLED_MAX_ANGULAR_SPEED 0.02f
+#define FREEZE_THAW_MARGIN 0.5f // meters around an impact in which frozen bodies are thawed
+
+// Freezing of long-settled stacks: dynamic bodies that stay asleep or (nearly) still for `settle_seconds` are converted to static bodies,
+// so a tall pile stops costing solver and broadphase work whenever a new piece wakes its island. They are thawed back to dynamic when a
+// line is cleared below them or something hits them faster than `impact_speed`.
 typedef struct {
-	b2ShapeId shape_id;
-	b2Vec2 pos;
-} ShapeInfo;
+	bool enabled;
+	float settle_seconds;
+	float impact_speed; // m/s
+} freeze_settings_t;
 
-int compare_shapes(const void *a, const void *b) {
-	ShapeInfo *shapeA = (ShapeInfo *)a;
-	ShapeInfo *shapeB = (ShapeInfo *)b;
-	return (shapeA->pos.x > shapeB->pos.x) - (shapeA->pos.x < shapeB->pos.x);
+static freeze_settings_t freeze_settings = {false, 3.0f, 3.0f};
+
+static void freeze_body(b2BodyId body_id, body_user_context *buc) {
+	b2Body_SetType(body_id, b2_staticBody);
+	buc->frozen = true;
 }
 
-typedef struct {
-	b2ShapeId shape_id;
-	b2Vec2 world_pos_pixels;
-} line_hit;
+static void thaw_body(b2BodyId body_id, body_user_context *buc) {
+	b2Body_SetType(body_id, b2_dynamicBody);
+	b2Body_SetAwake(body_id, true);
+	buc->frozen = false;
+	buc->settled_time = 0.0f;
+}
 
-// Comparison function for qsort to sort hits by their X-coordinate
-static int compare_hits_by_x(const void *a, const void *b) {
-	line_hit *hit_a = (line_hit *)a;
-	line_hit *hit_b = (line_hit *)b;
-	if (hit_a->world_pos_pixels.x < hit_b->world_pos_pixels.x)
-		return -1;
-	if (hit_a->world_pos_pixels.x > hit_b->world_pos_pixels.x)
-		return 1;
-	return 0;
+static void update_frozen_bodies(b2WorldId world_id, float dt) {
+	for (int i = 0; i < tracked_bodies.count; ++i) {
+		b2BodyId body_id = tracked_bodies.ids[i];
+		if (body_id.world0 != world_id.index1 - 1 || !b2Body_IsValid(body_id))
+			continue;
+		body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+		if (!buc || buc->frozen || buc->region_disabled)
+			continue;
+
+		bool settled = !b2Body_IsAwake(body_id) || (b2LengthSquared(b2Body_GetLinearVelocity(body_id)) < SETTLED_MAX_SPEED * SETTLED_MAX_SPEED &&
+													 fabsf(b2Body_GetAngularVelocity(body_id)) < SETTLED_MAX_ANGULAR_SPEED);
+		buc->settled_time = settled ? buc->settled_time + dt : 0.0f;
+		if (buc->settled_time >= freeze_settings.settle_seconds) {
+			freeze_body(body_id, buc);
+		}
+	}
 }
 
-// main line clear checking function - finds the shapes forming a suitable line at least `min_hits` long, return shape origins in world
-// pixel space (for effects) and list of affected bodies NOTE: unlike the rest of the C code, this is very much about game logic; could
-// perhaps rather be done in Ruby
-static mrb_value world_raycast(mrb_state *mrb, mrb_value self) {
-	b2WorldId *worldId = DATA_PTR(self);
-	mrb_float x1, y1, x2, y2;
-	mrb_int min_hits = 6;
-	mrb_float vertical_tolerance = 6.0f;
-	mrb_float horizontal_tolerance = 32.0f * 1.2f;
+typedef struct {
+	mrb_state *mrb;
+	body_id_list *frozen;
+} frozen_query_context;
+
+static bool frozen_query_callback(b2ShapeId shape_id, void *user_data) {
+	frozen_query_context *context = (frozen_query_context *)user_data;
+	b2BodyId body_id = b2Shape_GetBody(shape_id);
+	body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+	// the floor band below the active region stays frozen, see update_active_region
+	if (buc && buc->frozen && !buc->region_locked && !body_id_list_contains(context->frozen, body_id)) {
+		body_id_list_push(context->mrb, context->frozen, body_id);
+	}
+	return true;
+}
 
-	drb_api->mrb_get_args(mrb, "ffff|iff", &x1, &y1, &x2, &y2, &min_hits, &vertical_tolerance, &horizontal_tolerance);
+// thaws every frozen body overlapping `aabb` (meters); bodies are collected first as changing body types mid-query would modify the tree
+static void thaw_frozen_in_aabb(mrb_state *mrb, b2WorldId world_id, b2AABB aabb) {
+	body_id_list frozen = {0};
+	frozen_query_context context = {mrb, &frozen};
+	b2QueryFilter filter = b2DefaultQueryFilter();
+	filter.maskBits = TETROMINO_BIT;
+	b2World_OverlapAABB(world_id, aabb, filter, frozen_query_callback, &context);
+
+	for (int i = 0; i < frozen.count; ++i) {
+		thaw_body(frozen.ids[i], (body_user_context *)b2Body_GetUserData(frozen.ids[i]));
+	}
+	body_id_list_free(mrb, &frozen);
+}
+
+static void thaw_all_frozen(b2WorldId world_id) {
+	for (int i = 0; i < tracked_bodies.count; ++i) {
+		b2BodyId body_id = tracked_bodies.ids[i];
+		if (body_id.world0 != world_id.index1 - 1 || !b2Body_IsValid(body_id))
+			continue;
+		body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+		if (buc && buc->frozen && !buc->region_locked) {
+			thaw_body(body_id, buc);
+		}
+	}
+}
+
+// Jitter damping: some piles never fall asleep because a few bodies keep oscillating with tiny contact impulses, keeping whole islands
+// (and b2World_Step) busy. Slow bodies in contact whose vertical / angular velocity keeps flipping sign are flagged as jittering; after
+// `jitter_seconds` they get extra damping, and if that doesn't calm them down in the same time again they are forced to sleep.
+#define JITTER_MAX_SPEED 0.25f		   // m/s, anything faster is real motion
+#define JITTER_MAX_ANGULAR_SPEED 0.5f  // rad/s
+#define JITTER_FLIP_RATE 0.3f		   // fraction of steps with a velocity sign flip
+#define JITTER_FLIP_SMOOTHING 0.1f
+#define JITTER_LINEAR_DAMPING 2.0f
+#define JITTER_ANGULAR_DAMPING 4.0f
+
+typedef struct {
+	bool enabled;
+	float jitter_seconds;
+} jitter_settings_t;
+
+static jitter_settings_t jitter_settings = {false, 1.0f};
+
+static void restore_jitter_damping(b2BodyId body_id, body_user_context *buc) {
+	if (buc->damped) {
+		b2Body_SetLinearDamping(body_id, buc->base_linear_damping);
+		b2Body_SetAngularDamping(body_id, buc->base_angular_damping);
+		buc->damped = false;
+	}
+	buc->jitter_time = 0.0f;
+	buc->flip_rate = 0.0f;
+}
+
+// contact data buffer shared by all bodies of one update_jittering_bodies pass, grown as needed (tracked as scratch memory)
+typedef struct {
+	mrb_state *mrb;
+	b2ContactData *contacts;
+	int capacity;
+} contact_scratch;
+
+// looks at all of the body's contacts; a body in a packed pile easily has more than a handful
+static bool body_has_touching_contacts(contact_scratch *scratch, b2BodyId body_id) {
+	int capacity = b2Body_GetContactCapacity(body_id);
+	if (capacity == 0)
+		return false;
+	if (capacity > scratch->capacity) {
+		scratch->capacity = capacity;
+		scratch->contacts = tracked_realloc(scratch->mrb, scratch->contacts, sizeof(b2ContactData) * capacity, MEM_SCRATCH);
+	}
+	int count = b2Body_GetContactData(body_id, scratch->contacts, capacity);
+	for (int i = 0; i < count; ++i) {
+		if (scratch->contacts[i].manifold.pointCount > 0)
+			return true;
+	}
+	return false;
+}
+
+static void update_jittering_bodies(mrb_state *mrb, b2WorldId world_id, float dt) {
+	contact_scratch scratch = {mrb, NULL, 0};
+	for (int i = 0; i < tracked_bodies.count; ++i) {
+		b2BodyId body_id = tracked_bodies.ids[i];
+		if (body_id.world0 != world_id.index1 - 1 || !b2Body_IsValid(body_id))
+			continue;
+		body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+		if (!buc || buc->frozen || buc->region_disabled || !b2Body_IsAwake(body_id))
+			continue;
+
+		b2Vec2 v = b2Body_GetLinearVelocity(body_id);
+		float w = b2Body_GetAngularVelocity(body_id);
+		bool flipped = v.y * buc->prev_vy < 0.0f || w * buc->prev_angular_velocity < 0.0f;
+		buc->prev_vy = v.y;
+		buc->prev_angular_velocity = w;
+
+		if (b2Length(v) > JITTER_MAX_SPEED || fabsf(w) > JITTER_MAX_ANGULAR_SPEED || !body_has_touching_contacts(&scratch, body_id)) {
+			restore_jitter_damping(body_id, buc);
+			continue;
+		}
+
+		buc->flip_rate += JITTER_FLIP_SMOOTHING * ((flipped ? 1.0f : 0.0f) - buc->flip_rate);
+		buc->jitter_time = buc->flip_rate > JITTER_FLIP_RATE ? buc->jitter_time + dt : fmaxf(0.0f, buc->jitter_time - dt);
+
+		if (buc->jitter_time >= jitter_settings.jitter_seconds && !buc->damped) {
+			buc->base_linear_damping = b2Body_GetLinearDamping(body_id);
+			buc->base_angular_damping = b2Body_GetAngularDamping(body_id);
+			b2Body_SetLinearDamping(body_id, JITTER_LINEAR_DAMPING);
+			b2Body_SetAngularDamping(body_id, JITTER_ANGULAR_DAMPING);
+			buc->damped = true;
+		} else if (buc->jitter_time >= 2.0f * jitter_settings.jitter_seconds) {
+			b2Body_SetAwake(body_id, false); // puts the whole island to sleep
+			buc->jitter_time = 0.0f;
+		}
+	}
+	tracked_free(mrb, scratch.contacts);
+}
+
+// Active region for tall (endless) towers: only the bodies around the camera window take part in the simulation. Bodies whose top is
+// more than `band` below the region are disabled (b2Body_Disable removes them from the broadphase and the solver), the ones in the band
+// right below the region are frozen so they form a static floor for everything above. When the region moves down again (e.g. a clear
+// lowered the tower) the buried bodies are re-enabled. Line scans and rendering only look at the region.
+typedef struct {
+	bool enabled;
+	float min_y, max_y; // meters
+	float band;			// meters
+	float tower_top;	// top of the settled pile inside the region, meters
+	int disabled_count;
+} active_region_t;
+
+static active_region_t active_region = {0};
+
+static void update_active_region(mrb_state *mrb, b2WorldId world_id) {
+	float band_bottom = active_region.min_y - active_region.band;
+	active_region.tower_top = -INFINITY;
+	active_region.disabled_count = 0;
+	region_bodies.count = 0;
+
+	for (int i = 0; i < tracked_bodies.count; ++i) {
+		b2BodyId body_id = tracked_bodies.ids[i];
+		if (body_id.world0 != world_id.index1 - 1 || !b2Body_IsValid(body_id))
+			continue;
+		body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+		if (!buc)
+			continue;
+		if (buc->controlled) {
+			body_id_list_push(mrb, &region_bodies, body_id);
+			continue;
+		}
+
+		// buried bodies only cost this comparison
+		if (buc->region_disabled) {
+			if (buc->region_top < band_bottom) {
+				active_region.disabled_count++;
+				continue;
+			}
+			b2Body_Enable(body_id);
+			buc->region_disabled = false;
+		}
+
+		b2AABB aabb = b2Body_ComputeAABB(body_id);
+		float top = aabb.upperBound.y;
+		buc->in_region = top >= active_region.min_y && aabb.lowerBound.y <= active_region.max_y;
+		if (buc->in_region) {
+			body_id_list_push(mrb, &region_bodies, body_id);
+		}
+
+		if (top < band_bottom) {
+			b2Body_Disable(body_id);
+			buc->region_disabled = true;
+			buc->region_top = top;
+			active_region.disabled_count++;
+			continue;
+		}
+
+		if (top < active_region.min_y) {
+			if (!buc->frozen) {
+				freeze_body(body_id, buc);
+				buc->region_locked = true;
+			}
+		} else if (buc->region_locked) {
+			thaw_body(body_id, buc);
+			buc->region_locked = false;
+		}
+
+		if ((buc->frozen || !b2Body_IsAwake(body_id)) && top > active_region.tower_top) {
+			active_region.tower_top = top;
+		}
+	}
+}
+
+// re-enables and thaws everything the active region disabled or locked
+static void release_active_region(mrb_state *mrb, b2WorldId world_id) {
+	region_bodies.count = 0;
+	for (int i = 0; i < tracked_bodies.count; ++i) {
+		b2BodyId body_id = tracked_bodies.ids[i];
+		if (body_id.world0 != world_id.index1 - 1 || !b2Body_IsValid(body_id))
+			continue;
+		body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+		if (!buc)
+			continue;
+		if (buc->region_disabled) {
+			b2Body_Enable(body_id);
+			buc->region_disabled = false;
+		}
+		if (buc->region_locked) {
+			thaw_body(body_id, buc);
+			buc->region_locked = false;
+		}
+		buc->in_region = true;
+		body_id_list_push(mrb, &region_bodies, body_id);
+	}
+	active_region = (active_region_t){0};
+}
+
+// Line clear "puff" particles. Purely visual and in pixel space: a fixed capacity pool stored as structure-of-arrays so the
+// integrate / fade kernel is a set of branch free loops the compiler can vectorize. Emission happens natively in world_raycast for every
+// cleared cell; Ruby only fetches one packed buffer per frame for rendering (update_particles).
+#define PARTICLE_CAPACITY 4096
+#define PARTICLE_GRAVITY -220.0f // px/s^2, puffs drift down a bit
+#define PARTICLE_DRAG 2.5f		 // 1/s
+#define PARTICLE_SPEED 140.0f	 // px/s, max initial speed
+#define PARTICLE_MIN_LIFETIME 0.35f
+#define PARTICLE_MAX_LIFETIME 0.8f
+#define PARTICLE_START_SIZE 4.0f
+#define PARTICLE_END_SIZE 14.0f
+
+typedef struct {
+	_Alignas(32) float x[PARTICLE_CAPACITY];
+	_Alignas(32) float y[PARTICLE_CAPACITY];
+	_Alignas(32) float vx[PARTICLE_CAPACITY];
+	_Alignas(32) float vy[PARTICLE_CAPACITY];
+	_Alignas(32) float life[PARTICLE_CAPACITY];	  // seconds left
+	_Alignas(32) float inv_life[PARTICLE_CAPACITY]; // 1 / initial lifetime
+	int count;
+	int per_cell; // particles emitted per cleared cell, 0 disables emission
+	uint32_t rng;
+} particle_pool_t;
+
+static particle_pool_t particles = {.per_cell = 24, .rng = 0x9E3779B9u};
+
+// xorshift32, returns a float in [0, 1)
+static float particle_random(void) {
+	uint32_t x = particles.rng;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	particles.rng = x;
+	return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+static void emit_particles(float x, float y, int count) {
+	for (int i = 0; i < count && particles.count < PARTICLE_CAPACITY; ++i) {
+		int p = particles.count++;
+		float angle = particle_random() * 2.0f * (float)M_PI;
+		float speed = particle_random() * PARTICLE_SPEED;
+		float lifetime = PARTICLE_MIN_LIFETIME + particle_random() * (PARTICLE_MAX_LIFETIME - PARTICLE_MIN_LIFETIME);
+		particles.x[p] = x;
+		particles.y[p] = y;
+		particles.vx[p] = cosf(angle) * speed;
+		particles.vy[p] = sinf(angle) * speed;
+		particles.life[p] = lifetime;
+		particles.inv_life[p] = 1.0f / lifetime;
+	}
+}
+
+static void integrate_particles(float dt) {
+	float *restrict x = particles.x;
+	float *restrict y = particles.y;
+	float *restrict vx = particles.vx;
+	float *restrict vy = particles.vy;
+	float *restrict life = particles.life;
+	const float damping = fmaxf(0.0f, 1.0f - PARTICLE_DRAG * dt);
+	const float gravity_dv = PARTICLE_GRAVITY * dt;
+	const int count = particles.count;
+
+	for (int i = 0; i < count; ++i) {
+		vx[i] *= damping;
+		vy[i] = vy[i] * damping + gravity_dv;
+		x[i] += vx[i] * dt;
+		y[i] += vy[i] * dt;
+		life[i] -= dt;
+	}
+}
+
+// swap-removes dead particles; order doesn't matter for rendering
+static void compact_particles(void) {
+	int i = 0;
+	while (i < particles.count) {
+		if (particles.life[i] > 0.0f) {
+			i++;
+			continue;
+		}
+		int last = --particles.count;
+		particles.x[i] = particles.x[last];
+		particles.y[i] = particles.y[last];
+		particles.vx[i] = particles.vx[last];
+		particles.vy[i] = particles.vy[last];
+		particles.life[i] = particles.life[last];
+		particles.inv_life[i] = particles.inv_life[last];
+	}
+}
+
+typedef struct {
+	b2ShapeId shape_id;
+	b2Vec2 pos;
+} ShapeInfo;
+
+int compare_shapes(const void *a, const void *b) {
+	ShapeInfo *shapeA = (ShapeInfo *)a;
+	ShapeInfo *shapeB = (ShapeInfo *)b;
+	return (shapeA->pos.x > shapeB->pos.x) - (shapeA->pos.x < shapeB->pos.x);
+}
 
+typedef struct {
+	b2ShapeId shape_id;
+	uint8_t cell_mask; // cell of a merged tetromino proxy this hit stands for, 0 when it's the whole shape
+	b2Vec2 world_pos_pixels;
+} line_hit;
+
+// slab test of the segment a-b against an axis aligned square
+static bool segment_overlaps_square(b2Vec2 a, b2Vec2 b, b2Vec2 center, float half_size) {
+	float origin[2] = {a.x - center.x, a.y - center.y};
+	float delta[2] = {b.x - a.x, b.y - a.y};
+	float t_min = 0.0f;
+	float t_max = 1.0f;
+	for (int axis = 0; axis < 2; ++axis) {
+		if (fabsf(delta[axis]) < 1e-6f) {
+			if (fabsf(origin[axis]) > half_size)
+				return false;
+			continue;
+		}
+		float t1 = (-half_size - origin[axis]) / delta[axis];
+		float t2 = (half_size - origin[axis]) / delta[axis];
+		t_min = fmaxf(t_min, fminf(t1, t2));
+		t_max = fminf(t_max, fmaxf(t1, t2));
+		if (t_min > t_max)
+			return false;
+	}
+	return true;
+}
+
+// Comparison function for qsort to sort hits by their X-coordinate
+static int compare_hits_by_x(const void *a, const void *b) {
+	line_hit *hit_a = (line_hit *)a;
+	line_hit *hit_b = (line_hit *)b;
+	if (hit_a->world_pos_pixels.x < hit_b->world_pos_pixels.x)
+		return -1;
+	if (hit_a->world_pos_pixels.x > hit_b->world_pos_pixels.x)
+		return 1;
+	return 0;
+}
+
+// main line clear checking function - finds the shapes forming a suitable line at least `min_hits` long along one ray and destroys
+// them. Shape origins in world pixel space (for effects) are appended to `cleared_points_ary`, every ray hit to `all_hits_ary` (debug) and
+// the affected bodies to `affected`; their mass is only recomputed in finish_line_clears, once per body however many lines hit it.
+// NOTE: unlike the rest of the C code, this is very much about game logic; could perhaps rather be done in Ruby
+static void clear_line(mrb_state *mrb, b2WorldId world_id, float x1, float y1, float x2, float y2, int min_hits, float vertical_tolerance,
+					   float horizontal_tolerance, mrb_value cleared_points_ary, mrb_value all_hits_ary, body_id_list *affected) {
+	TRACE_SCOPE("clear_line");
 	b2Vec2 p1 = pixels_to_meters(x1, y1);
 	b2Vec2 p2 = pixels_to_meters(x2, y2);
 	b2Vec2 tr = b2Sub(p2, p1);
@@ -564,26 +1379,17 @@ static mrb_value world_raycast(mrb_state *mrb, mrb_value self) {
 	b2QueryFilter filter = b2DefaultQueryFilter();
 	filter.maskBits = TETROMINO_BIT;
 
-	b2World_CastRay(*worldId, p1, tr, filter, raycast_callback, &ray_collection);
-
-	mrb_value results = drb_api->mrb_hash_new(mrb);
-	drb_api->mrb_hash_set(mrb, results, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "bodies_to_split")),
-						  drb_api->mrb_ary_new(mrb));
-	drb_api->mrb_hash_set(mrb, results, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "cleared_points")),
-						  drb_api->mrb_ary_new(mrb));
-
-	// DEBUG: All raycast hits are returned for debug purposes (display on Ruby side)
-	mrb_value all_hits_ary = drb_api->mrb_ary_new(mrb);
-	drb_api->mrb_hash_set(mrb, results, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "all_hits")), all_hits_ary);
+	b2World_CastRay(world_id, p1, tr, filter, raycast_callback, &ray_collection);
 
 	if (ray_collection.count < min_hits) {
-		return results;
+		return;
 	}
 
-	line_hit *candidates = drb_api->mrb_malloc(mrb, sizeof(line_hit) * ray_collection.count);
+	// merged tetromino proxies can stand for several cells each
+	line_hit *candidates = tracked_malloc(mrb, sizeof(line_hit) * ray_collection.count * TETROMINO_CELL_COUNT, MEM_SCRATCH);
 	int candidate_count = 0;
 	float total_y = 0;
-	const float max_velocity_sq = 0.01f * 0.01f;
+	const float max_velocity_sq = SETTLED_MAX_SPEED * SETTLED_MAX_SPEED;
 
 	// we filter hits by velocity and alignment to try to only match relatively stable horizontal lines
 	for (int i = 0; i < ray_collection.count; ++i) {
@@ -597,125 +1403,1069 @@ static mrb_value world_raycast(mrb_state *mrb, mrb_value self) {
 		}
 
 		b2Transform transform = b2Body_GetTransform(body_id);
-		b2Polygon poly = b2Shape_GetPolygon(shape_id);
-		b2Vec2 world_pos_meters = b2TransformPoint(transform, poly.centroid);
+		body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+		if (buc && buc->region_locked)
+			continue; // the floor band below the active region isn't part of the playfield
+		uint8_t mask = shape_cell_mask(shape_id);
+
+		// a merged proxy is expanded into the cells the ray actually passes through, so lines are still detected per cell
+		line_hit shape_hits[TETROMINO_CELL_COUNT];
+		int shape_hit_count = 0;
+		if (cell_mask_count(mask) > 1 && buc && buc->tetromino_kind >= 0) {
+			b2Vec2 local_p1 = b2InvTransformPoint(transform, p1);
+			b2Vec2 local_p2 = b2InvTransformPoint(transform, p2);
+			float half_size_m = buc->square_size_px / PIXELS_PER_METER / 2.0f;
+			for (int c = 0; c < TETROMINO_CELL_COUNT; ++c) {
+				if (!(mask & (1u << c)))
+					continue;
+				b2Vec2 center = tetromino_cell_center(buc->tetromino_kind, c, buc->square_size_px);
+				if (segment_overlaps_square(local_p1, local_p2, center, half_size_m)) {
+					b2Vec2 world_pos_meters = b2TransformPoint(transform, center);
+					shape_hits[shape_hit_count++] =
+						(line_hit){shape_id, (uint8_t)(1u << c), meters_to_pixels(world_pos_meters.x, world_pos_meters.y)};
+				}
+			}
+		} else {
+			b2Polygon poly = b2Shape_GetPolygon(shape_id);
+			b2Vec2 world_pos_meters = b2TransformPoint(transform, poly.centroid);
+			shape_hits[shape_hit_count++] = (line_hit){shape_id, 0, meters_to_pixels(world_pos_meters.x, world_pos_meters.y)};
+		}
 
-		b2Vec2 pixel_pos = meters_to_pixels(world_pos_meters.x, world_pos_meters.y);
+		for (int h = 0; h < shape_hit_count; ++h) {
+			b2Vec2 pixel_pos = shape_hits[h].world_pos_pixels;
 
-		// DEBUG: populating the all_hits array in `results`
-		mrb_value hit_hash = drb_api->mrb_hash_new(mrb);
-		drb_api->mrb_hash_set(mrb, hit_hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "x")),
-							  drb_api->mrb_float_value(mrb, pixel_pos.x));
-		drb_api->mrb_hash_set(mrb, hit_hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "y")),
-							  drb_api->mrb_float_value(mrb, pixel_pos.y));
-		drb_api->mrb_ary_push(mrb, all_hits_ary, hit_hash);
+			// DEBUG: populating the all_hits array in `results`
+			mrb_value hit_hash = drb_api->mrb_hash_new(mrb);
+			drb_api->mrb_hash_set(mrb, hit_hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "x")),
+								  drb_api->mrb_float_value(mrb, pixel_pos.x));
+			drb_api->mrb_hash_set(mrb, hit_hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "y")),
+								  drb_api->mrb_float_value(mrb, pixel_pos.y));
+			drb_api->mrb_ary_push(mrb, all_hits_ary, hit_hash);
 
-		candidates[candidate_count].shape_id = shape_id;
-		candidates[candidate_count].world_pos_pixels = pixel_pos;
-		total_y += candidates[candidate_count].world_pos_pixels.y;
-		candidate_count++;
+			candidates[candidate_count] = shape_hits[h];
+			total_y += pixel_pos.y;
+			candidate_count++;
+		}
 	}
 
 	if (candidate_count < min_hits) {
-		drb_api->mrb_free(mrb, candidates);
-		return results;
+		tracked_free(mrb, candidates);
+		return;
+	}
+
+	float avg_y = total_y / candidate_count;
+	line_hit *aligned_hits = tracked_malloc(mrb, sizeof(line_hit) * candidate_count, MEM_SCRATCH);
+	int aligned_count = 0;
+	for (int i = 0; i < candidate_count; ++i) {
+		if (fabs(candidates[i].world_pos_pixels.y - avg_y) < vertical_tolerance) {
+			aligned_hits[aligned_count++] = candidates[i];
+		}
+	}
+	tracked_free(mrb, candidates);
+
+	if (aligned_count < min_hits) {
+		tracked_free(mrb, aligned_hits);
+		return;
+	}
+
+	// TODO: Does Box2D give any guarantees on hit order - meaning is this necessary?
+	qsort(aligned_hits, aligned_count, sizeof(line_hit), compare_hits_by_x);
+
+	line_hit *largest_group = NULL;
+	int max_group_size = 0;
+	int current_group_start = 0;
+	// find largest group, i.e. biggest grouping of vertically aligned shapes within horizontal limits
+	for (int i = 1; i <= aligned_count; ++i) {
+		// A group ends if we reach the end of the array OR the next shape is too far away
+		if (i == aligned_count || aligned_hits[i].world_pos_pixels.x - aligned_hits[i - 1].world_pos_pixels.x > horizontal_tolerance) {
+			int current_group_size = i - current_group_start;
+			if (current_group_size > max_group_size) {
+				max_group_size = current_group_size;
+				largest_group = &aligned_hits[current_group_start];
+			}
+			current_group_start = i;
+		}
+	}
+
+	// we can now assume the 'largest group' constitues an approximation of a horizontal line -> destroy the shapes it has and return the
+	// list of affected bodies from it
+	if (max_group_size >= min_hits) {
+		// cells of merged proxies are collected per shape first; the shape can only be rebuilt once
+		line_hit *cell_clears = tracked_malloc(mrb, sizeof(line_hit) * max_group_size, MEM_SCRATCH);
+		int cell_clear_count = 0;
+
+		for (int i = 0; i < max_group_size; ++i) {
+			line_hit hit = largest_group[i];
+			b2BodyId body_id = b2Shape_GetBody(hit.shape_id);
+			if (!body_id_list_contains(affected, body_id)) {
+				body_id_list_push(mrb, affected, body_id);
+			}
+
+			// Add the shape's position to the return data for visual effects
+			mrb_value hit_hash = drb_api->mrb_hash_new(mrb);
+			drb_api->mrb_hash_set(mrb, hit_hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "x")),
+								  drb_api->mrb_float_value(mrb, hit.world_pos_pixels.x));
+			drb_api->mrb_hash_set(mrb, hit_hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "y")),
+								  drb_api->mrb_float_value(mrb, hit.world_pos_pixels.y));
+			drb_api->mrb_ary_push(mrb, cleared_points_ary, hit_hash);
+			emit_particles(hit.world_pos_pixels.x, hit.world_pos_pixels.y, particles.per_cell);
+
+			if (hit.cell_mask == 0) {
+				b2DestroyShape(hit.shape_id, false);
+				continue;
+			}
+			int c = 0;
+			while (c < cell_clear_count && !B2_ID_EQUALS(cell_clears[c].shape_id, hit.shape_id))
+				c++;
+			if (c == cell_clear_count) {
+				cell_clears[cell_clear_count++] = hit;
+			} else {
+				cell_clears[c].cell_mask |= hit.cell_mask;
+			}
+		}
+
+		for (int i = 0; i < cell_clear_count; ++i) {
+			remove_shape_cells(cell_clears[i].shape_id, cell_clears[i].cell_mask);
+		}
+		tracked_free(mrb, cell_clears);
+
+		// everything frozen on top of the cleared line has to be able to fall down again, however tall the level (Endless Tower)
+		if (freeze_settings.enabled) {
+			b2Vec2 line_bottom = pixels_to_meters(fminf(x1, x2), avg_y - vertical_tolerance);
+			b2AABB above_line = {{line_bottom.x, line_bottom.y}, {fmaxf(x1, x2) / PIXELS_PER_METER, FLT_MAX}};
+			thaw_frozen_in_aabb(mrb, world_id, above_line);
+		}
+	}
+
+	tracked_free(mrb, aligned_hits);
+}
+
+// recomputes the mass of every body that lost shapes (once each) and pushes their Ruby objects to `bodies_ary` for splitting
+static void finish_line_clears(mrb_state *mrb, body_id_list *affected, mrb_value bodies_ary) {
+	for (int i = 0; i < affected->count; i++) {
+		b2BodyId body_id = affected->ids[i];
+		if (!b2Body_IsValid(body_id))
+			continue;
+		b2Body_ApplyMassFromShapes(body_id);
+		body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+		if (buc && !mrb_nil_p(buc->body_obj)) {
+			drb_api->mrb_ary_push(mrb, bodies_ary, buc->body_obj);
+		}
+	}
+	body_id_list_free(mrb, affected);
+}
+
+static mrb_value new_line_clear_results(mrb_state *mrb) {
+	mrb_value results = drb_api->mrb_hash_new(mrb);
+	drb_api->mrb_hash_set(mrb, results, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "bodies_to_split")),
+						  drb_api->mrb_ary_new(mrb));
+	drb_api->mrb_hash_set(mrb, results, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "cleared_points")),
+						  drb_api->mrb_ary_new(mrb));
+	return results;
+}
+
+static mrb_value results_array(mrb_state *mrb, mrb_value results, const char *key) {
+	return drb_api->mrb_hash_get(mrb, results, drb_api->mrb_symbol_value(drb_api->mrb_intern_cstr(mrb, key)));
+}
+
+// raycast(x1, y1, x2, y2, min_hits = 6, vertical_tolerance = 6, horizontal_tolerance = 38.4) - clears a single line, returns
+// { cleared_points:, bodies_to_split:, all_hits: }
+static mrb_value world_raycast(mrb_state *mrb, mrb_value self) {
+	TRACE_SCOPE("raycast");
+	b2WorldId *worldId = DATA_PTR(self);
+	mrb_float x1, y1, x2, y2;
+	mrb_int min_hits = 6;
+	mrb_float vertical_tolerance = 6.0f;
+	mrb_float horizontal_tolerance = 32.0f * 1.2f;
+	drb_api->mrb_get_args(mrb, "ffff|iff", &x1, &y1, &x2, &y2, &min_hits, &vertical_tolerance, &horizontal_tolerance);
+
+	mrb_value results = new_line_clear_results(mrb);
+	// DEBUG: All raycast hits are returned for debug purposes (display on Ruby side)
+	mrb_value all_hits_ary = drb_api->mrb_ary_new(mrb);
+	drb_api->mrb_hash_set(mrb, results, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "all_hits")), all_hits_ary);
+
+	body_id_list affected = {0};
+	clear_line(mrb, *worldId, x1, y1, x2, y2, (int)min_hits, vertical_tolerance, horizontal_tolerance,
+			   results_array(mrb, results, "cleared_points"), all_hits_ary, &affected);
+	finish_line_clears(mrb, &affected, results_array(mrb, results, "bodies_to_split"));
+	return results;
+}
+
+// scan_lines(x1, x2, ys, min_hits = 6, vertical_tolerance = 6, horizontal_tolerance = 38.4) - clears the horizontal lines from x1 to x2 at
+// each of the `ys` in one go, skipping the ones outside of the active region. Returns { cleared_points:, bodies_to_split:, all_hits: [hits of ys[0], hits of ys[1], ...] }, every
+// affected body is listed (and has its mass recomputed) once.
+static mrb_value world_scan_lines(mrb_state *mrb, mrb_value self) {
+	TRACE_SCOPE("scan_lines");
+	b2WorldId *worldId = DATA_PTR(self);
+	mrb_float x1, x2;
+	mrb_value ys;
+	mrb_int min_hits = 6;
+	mrb_float vertical_tolerance = 6.0f;
+	mrb_float horizontal_tolerance = 32.0f * 1.2f;
+	drb_api->mrb_get_args(mrb, "ffA|iff", &x1, &x2, &ys, &min_hits, &vertical_tolerance, &horizontal_tolerance);
+
+	mrb_value results = new_line_clear_results(mrb);
+	mrb_value cleared_points_ary = results_array(mrb, results, "cleared_points");
+	mrb_value all_hits_per_line = drb_api->mrb_ary_new(mrb);
+	drb_api->mrb_hash_set(mrb, results, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "all_hits")), all_hits_per_line);
+
+	body_id_list affected = {0};
+	mrb_int line_count = RARRAY_LEN(ys);
+	for (mrb_int i = 0; i < line_count; ++i) {
+		float y = drb_api->mrb_to_flo(mrb, drb_api->mrb_ary_entry(ys, i));
+		mrb_value all_hits_ary = drb_api->mrb_ary_new(mrb);
+		drb_api->mrb_ary_push(mrb, all_hits_per_line, all_hits_ary);
+		if (active_region.enabled && (y < active_region.min_y * PIXELS_PER_METER || y > active_region.max_y * PIXELS_PER_METER))
+			continue;
+		clear_line(mrb, *worldId, x1, y, x2, y, (int)min_hits, vertical_tolerance, horizontal_tolerance, cleared_points_ary, all_hits_ary,
+				   &affected);
+	}
+	finish_line_clears(mrb, &affected, results_array(mrb, results, "bodies_to_split"));
+	return results;
+}
+
+// placement queries: spawn clearance and drop landing prediction are answered with broadphase shape queries against the tetromino
+// templates instead of spawning a body and polling collided? for a few frames
+#define PLACEMENT_INSET_PX 1.0f // cells are shrunk a bit so that merely touching a neighbour doesn't count as overlapping
+
+static b2QueryFilter placement_query_filter(void) {
+	b2QueryFilter filter = b2DefaultQueryFilter();
+	filter.categoryBits = TETROMINO_BIT;
+	filter.maskBits = TETROMINO_BIT | GROUND_BIT;
+	return filter;
+}
+
+static bool placement_overlap_callback(b2ShapeId shape_id, void *user_data) {
+	if (b2Shape_IsSensor(shape_id)) {
+		return true;
+	}
+	*(bool *)user_data = true;
+	return false; // one overlap is enough to reject the placement
+}
+
+// can_place(kind, x, y, angle, square_size = 40) - true if a tetromino of `kind` ("t", "o", "l", "j", "i", "s", "z") fits at the given
+// pixel position and angle (degrees) without overlapping any block or terrain
+static mrb_value world_can_place(mrb_state *mrb, mrb_value self) {
+	b2WorldId *worldId = DATA_PTR(self);
+	mrb_value kind_str;
+	mrb_float x, y, angle;
+	mrb_float square_size_px = 40.0f;
+	drb_api->mrb_get_args(mrb, "Sfff|f", &kind_str, &x, &y, &angle, &square_size_px);
+
+	int kind = tetromino_kind_from_name(drb_api->mrb_str_to_cstr(mrb, kind_str));
+	if (kind < 0) {
+		printf("[CExt] -- WARNING: can_place called with an unknown tetromino kind\n");
+		return mrb_nil_value();
+	}
+
+	b2Vec2 position = pixels_to_meters(x, y);
+	b2Rot rotation = b2MakeRot(angle * DEGTORAD);
+	b2QueryFilter filter = placement_query_filter();
+
+	bool overlaps = false;
+	for (int i = 0; i < TETROMINO_MAX_PROXIES && TETROMINO_PROXIES[kind][i] && !overlaps; ++i) {
+		b2Polygon cell = tetromino_mask_polygon(kind, TETROMINO_PROXIES[kind][i], square_size_px, PLACEMENT_INSET_PX);
+		b2ShapeProxy proxy = b2MakeOffsetProxy(cell.vertices, cell.count, cell.radius, position, rotation);
+		b2World_OverlapShape(*worldId, &proxy, filter, placement_overlap_callback, &overlaps);
+	}
+
+	return mrb_bool_value(!overlaps);
+}
+
+typedef struct {
+	b2BodyId ignored_body;
+	float fraction;
+} landing_cast_context;
+
+static float landing_cast_callback(b2ShapeId shape_id, b2Vec2 point, b2Vec2 normal, float fraction, void *user_data) {
+	landing_cast_context *context = (landing_cast_context *)user_data;
+	if (b2Shape_IsSensor(shape_id) || B2_ID_EQUALS(b2Shape_GetBody(shape_id), context->ignored_body)) {
+		return -1.0f; // filter out and keep going
+	}
+	if (fraction < context->fraction) {
+		context->fraction = fraction;
+	}
+	return fraction; // clip the cast to the closest hit so far
+}
+
+// predict_landing(body, max_distance = 2000) - casts the body's shapes straight down and returns where it would come to rest as a hash
+// { x:, y:, angle:, distance: } in pixels / degrees (e.g. for a ghost-piece indicator), nil if nothing is hit within max_distance
+static mrb_value world_predict_landing(mrb_state *mrb, mrb_value self) {
+	b2WorldId *worldId = DATA_PTR(self);
+	mrb_value body_obj;
+	mrb_float max_distance_px = 2000.0f;
+	drb_api->mrb_get_args(mrb, "o|f", &body_obj, &max_distance_px);
+
+	b2BodyId *bodyId = DATA_PTR(body_obj);
+	if (!bodyId || !b2Body_IsValid(*bodyId)) {
+		return mrb_nil_value();
+	}
+
+	int shape_count = b2Body_GetShapeCount(*bodyId);
+	if (shape_count == 0) {
+		return mrb_nil_value();
+	}
+	b2ShapeId *shape_ids = tracked_malloc(mrb, sizeof(b2ShapeId) * shape_count, MEM_SCRATCH);
+	shape_count = b2Body_GetShapes(*bodyId, shape_ids, shape_count);
+
+	b2Transform transform = b2Body_GetTransform(*bodyId);
+	b2Vec2 translation = {0.0f, -max_distance_px / PIXELS_PER_METER};
+	landing_cast_context context = {*bodyId, 1.0f};
+	bool hit = false;
+
+	for (int i = 0; i < shape_count; ++i) {
+		if (b2Shape_GetType(shape_ids[i]) != b2_polygonShape || b2Shape_IsSensor(shape_ids[i]))
+			continue;
+		b2Polygon poly = b2Shape_GetPolygon(shape_ids[i]);
+		b2ShapeProxy proxy = b2MakeOffsetProxy(poly.vertices, poly.count, poly.radius, transform.p, transform.q);
+		float previous = context.fraction;
+		b2World_CastShape(*worldId, &proxy, translation, placement_query_filter(), landing_cast_callback, &context);
+		hit = hit || context.fraction < previous;
+	}
+	tracked_free(mrb, shape_ids);
+
+	if (!hit) {
+		return mrb_nil_value();
+	}
+
+	float distance_m = context.fraction * -translation.y;
+	b2Vec2 landing = meters_to_pixels(transform.p.x, transform.p.y - distance_m);
+
+	mrb_value hash = drb_api->mrb_hash_new(mrb);
+	drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "x")), drb_api->mrb_float_value(mrb, landing.x));
+	drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "y")), drb_api->mrb_float_value(mrb, landing.y));
+	drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "angle")),
+						  drb_api->mrb_float_value(mrb, b2Rot_GetAngle(transform.q) * RAD2DEG));
+	drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "distance")),
+						  drb_api->mrb_float_value(mrb, distance_m * PIXELS_PER_METER));
+	return hash;
+}
+
+// placement search: candidate drops (kind, x, angle) are simulated forward in scratch worlds rebuilt from a snapshot of the live world and
+// scored by the lines they'd complete, the height they leave and how much the stack is still moving. Box2D can't clone a world and
+// creating / destroying worlds isn't thread safe, so the scratch worlds are created on the main thread and only filled, stepped and scored
+// on the worker threads. Workers never call into mruby.
+#define PLACEMENT_MAX_THREADS 8
+#define PLACEMENT_DT (1.0f / 60.0f)
+#define PLACEMENT_SUBSTEPS 4
+#define PLACEMENT_DROP_GAP_PX 1.0f // candidates start this far above where a straight drop would land them
+#define PLACEMENT_SNAPSHOT_EXTENT 10000.0f // half size (meters) of the box that is queried for the shapes to snapshot
+#define PLACEMENT_SIMULATE_TOP 24 // candidates that get the full simulation, by their landing score
+// score weights: a completed line is worth several cells of height, motion is in cells per second summed over all bodies
+#define PLACEMENT_LINE_WEIGHT 10.0f
+#define PLACEMENT_HEIGHT_WEIGHT 1.0f
+#define PLACEMENT_MOTION_WEIGHT 2.0f
+#define PLACEMENT_LOST_PENALTY 1000.0f
+
+typedef struct {
+	b2ShapeType type; // b2_polygonShape or b2_segmentShape (chain segments are copied as plain segments)
+	b2Polygon polygon;
+	b2Segment segment;
+	b2ShapeDef def;
+} snapshot_shape;
+
+typedef struct {
+	b2BodyDef def;
+	int tetromino_kind;
+	float square_size_px;
+	uint8_t cell_mask; // cells the body still has, from its shapes
+	int first_shape;
+	int shape_count;
+} snapshot_body;
+
+typedef struct {
+	snapshot_body *bodies;
+	int body_count;
+	snapshot_shape *shapes;
+	int shape_count;
+} world_snapshot;
+
+typedef struct {
+	b2ShapeId shape_id;
+	b2BodyId body_id;
+} snapshot_shape_ref;
+
+typedef struct {
+	mrb_state *mrb;
+	snapshot_shape_ref *refs;
+	int count;
+	int capacity;
+} snapshot_query_context;
+
+static bool snapshot_query_callback(b2ShapeId shape_id, void *user_data) {
+	snapshot_query_context *context = (snapshot_query_context *)user_data;
+	b2ShapeType type = b2Shape_GetType(shape_id);
+	if (b2Shape_IsSensor(shape_id) || (type != b2_polygonShape && type != b2_segmentShape && type != b2_chainSegmentShape)) {
+		return true;
+	}
+	b2BodyId body_id = b2Shape_GetBody(shape_id);
+	body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+	if (buc && buc->controlled) {
+		return true; // the active piece is what the candidates replace
+	}
+	if (context->count == context->capacity) {
+		context->capacity = context->capacity ? context->capacity * 2 : 256;
+		context->refs = tracked_realloc(context->mrb, context->refs, sizeof(snapshot_shape_ref) * context->capacity, MEM_SCRATCH);
+	}
+	context->refs[context->count++] = (snapshot_shape_ref){shape_id, body_id};
+	return true;
+}
+
+static int compare_shape_refs_by_body(const void *a, const void *b) {
+	int32_t body_a = ((const snapshot_shape_ref *)a)->body_id.index1;
+	int32_t body_b = ((const snapshot_shape_ref *)b)->body_id.index1;
+	return (body_a > body_b) - (body_a < body_b);
+}
+
+// copies every enabled body with polygon / segment shapes (except the controlled piece) into plain structs the workers can rebuild from
+static void take_world_snapshot(mrb_state *mrb, b2WorldId world_id, world_snapshot *snapshot) {
+	snapshot_query_context context = {mrb, NULL, 0, 0};
+	b2AABB everything = {{-PLACEMENT_SNAPSHOT_EXTENT, -PLACEMENT_SNAPSHOT_EXTENT}, {PLACEMENT_SNAPSHOT_EXTENT, PLACEMENT_SNAPSHOT_EXTENT}};
+	b2QueryFilter filter = b2DefaultQueryFilter();
+	filter.categoryBits = UINT64_MAX;
+	filter.maskBits = UINT64_MAX;
+	b2World_OverlapAABB(world_id, everything, filter, snapshot_query_callback, &context);
+	qsort(context.refs, context.count, sizeof(snapshot_shape_ref), compare_shape_refs_by_body);
+
+	*snapshot = (world_snapshot){0};
+	snapshot->shapes = tracked_malloc(mrb, sizeof(snapshot_shape) * (context.count ? context.count : 1), MEM_SCRATCH);
+	snapshot->bodies = tracked_malloc(mrb, sizeof(snapshot_body) * (context.count ? context.count : 1), MEM_SCRATCH);
+
+	for (int i = 0; i < context.count; ++i) {
+		b2ShapeId shape_id = context.refs[i].shape_id;
+		b2BodyId body_id = context.refs[i].body_id;
+
+		if (i == 0 || !B2_ID_EQUALS(body_id, context.refs[i - 1].body_id)) {
+			body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+			b2Transform transform = b2Body_GetTransform(body_id);
+			snapshot_body *body = &snapshot->bodies[snapshot->body_count++];
+			*body = (snapshot_body){0};
+			body->def = b2DefaultBodyDef();
+			body->def.type = b2Body_GetType(body_id);
+			body->def.position = transform.p;
+			body->def.rotation = transform.q;
+			body->def.linearVelocity = b2Body_GetLinearVelocity(body_id);
+			body->def.angularVelocity = b2Body_GetAngularVelocity(body_id);
+			body->def.linearDamping = b2Body_GetLinearDamping(body_id);
+			body->def.angularDamping = b2Body_GetAngularDamping(body_id);
+			body->def.gravityScale = b2Body_GetGravityScale(body_id);
+			body->def.enableSleep = b2Body_IsSleepEnabled(body_id);
+			body->def.isAwake = b2Body_IsAwake(body_id);
+			body->tetromino_kind = buc ? buc->tetromino_kind : -1;
+			body->square_size_px = buc ? buc->square_size_px : 0.0f;
+			body->first_shape = snapshot->shape_count;
+		}
+		snapshot_body *body = &snapshot->bodies[snapshot->body_count - 1];
+
+		snapshot_shape *shape = &snapshot->shapes[snapshot->shape_count++];
+		shape->def = b2DefaultShapeDef();
+		shape->def.density = b2Shape_GetDensity(shape_id);
+		shape->def.material.friction = b2Shape_GetFriction(shape_id);
+		shape->def.material.restitution = b2Shape_GetRestitution(shape_id);
+		shape->def.filter = b2Shape_GetFilter(shape_id);
+		shape->def.userData = b2Shape_GetUserData(shape_id);
+		shape->def.enableContactEvents = false; // scratch worlds don't process events
+		shape->def.updateBodyMass = false;
+		switch (b2Shape_GetType(shape_id)) {
+		case b2_polygonShape:
+			shape->type = b2_polygonShape;
+			shape->polygon = b2Shape_GetPolygon(shape_id);
+			break;
+		case b2_segmentShape:
+			shape->type = b2_segmentShape;
+			shape->segment = b2Shape_GetSegment(shape_id);
+			break;
+		default:
+			shape->type = b2_segmentShape;
+			shape->segment = b2Shape_GetChainSegment(shape_id).segment;
+			break;
+		}
+		body->cell_mask |= shape_cell_mask(shape_id);
+		body->shape_count++;
+	}
+	tracked_free(mrb, context.refs);
+}
+
+static void free_world_snapshot(mrb_state *mrb, world_snapshot *snapshot) {
+	tracked_free(mrb, snapshot->bodies);
+	tracked_free(mrb, snapshot->shapes);
+}
+
+typedef struct {
+	int kind;
+	float x, angle; // pixels, degrees
+	bool landed;	// the straight drop hits something, see land_placement
+	b2Vec2 drop;	// where the simulated drop starts (meters)
+	bool evaluated; // simulated and scored within the budget
+	bool lost;		// fell past the lowest line (or nothing to land on)
+	int lines;
+	float height;	 // top of the piece after the simulation, pixels
+	float motion;	 // summed body speed at the end, pixels per second
+	b2Transform rest; // where the piece ended up (meters)
+	float score;
+} placement_candidate;
+
+typedef struct {
+	const world_snapshot *snapshot;
+	placement_candidate *candidates;
+	int candidate_count;
+	int simulate_count; // the first simulate_count candidates (after ranking) are simulated
+	atomic_int next;
+	atomic_int running; // worker threads that haven't returned yet
+	atomic_bool cancelled; // stop now, see cancel_placement_search
+	uint64_t deadline_us;
+	float density, friction, restitution;
+	float square_size_px;
+	float spawn_y;
+	const float *line_ys;
+	int line_count;
+	float lowest_line_y;
+	int min_hits;
+	int steps;
+} placement_search;
+
+typedef struct {
+	placement_search *search;
+	int index;
+	b2WorldId world_id;
+	b2BodyId *bodies; // one per snapshot body, destroyed again after each candidate
+	int *line_hits;
+} placement_worker;
+
+static void fill_scratch_world(placement_worker *worker) {
+	const world_snapshot *snapshot = worker->search->snapshot;
+	for (int i = 0; i < snapshot->body_count; ++i) {
+		const snapshot_body *body = &snapshot->bodies[i];
+		b2BodyId body_id = b2CreateBody(worker->world_id, &body->def);
+		for (int s = body->first_shape; s < body->first_shape + body->shape_count; ++s) {
+			const snapshot_shape *shape = &snapshot->shapes[s];
+			if (shape->type == b2_polygonShape) {
+				b2CreatePolygonShape(body_id, &shape->def, &shape->polygon);
+			} else {
+				b2CreateSegmentShape(body_id, &shape->def, &shape->segment);
+			}
+		}
+		if (body->def.type == b2_dynamicBody) {
+			b2Body_ApplyMassFromShapes(body_id);
+		}
+		worker->bodies[i] = body_id;
+	}
+}
+
+// counts the piece's cells (mask, kind) into the worker's line hits
+static void count_line_cells(placement_worker *worker, b2Transform transform, int kind, uint8_t mask, float square_size_px) {
+	const placement_search *search = worker->search;
+	for (int cell = 0; cell < TETROMINO_CELL_COUNT; ++cell) {
+		if (!(mask & (1u << cell)))
+			continue;
+		float y = b2TransformPoint(transform, tetromino_cell_center(kind, cell, square_size_px)).y * PIXELS_PER_METER;
+		for (int l = 0; l < search->line_count; ++l) {
+			if (fabsf(y - search->line_ys[l]) <= square_size_px * 0.5f) {
+				worker->line_hits[l]++;
+			}
+		}
+	}
+}
+
+// bodies without a tetromino kind (split remnants, plain boxes) count one cell per polygon shape at its centroid, like line detection
+static void count_shape_cells(placement_worker *worker, b2Transform transform, const snapshot_body *body) {
+	const placement_search *search = worker->search;
+	for (int s = body->first_shape; s < body->first_shape + body->shape_count; ++s) {
+		const snapshot_shape *shape = &search->snapshot->shapes[s];
+		if (shape->type != b2_polygonShape || !(shape->def.filter.categoryBits & TETROMINO_BIT))
+			continue;
+		float y = b2TransformPoint(transform, shape->polygon.centroid).y * PIXELS_PER_METER;
+		for (int l = 0; l < search->line_count; ++l) {
+			if (fabsf(y - search->line_ys[l]) <= search->square_size_px * 0.5f) {
+				worker->line_hits[l]++;
+			}
+		}
+	}
+}
+
+static float body_motion_px(b2BodyId body_id, float square_size_px) {
+	if (b2Body_GetType(body_id) != b2_dynamicBody)
+		return 0.0f;
+	return b2Length(b2Body_GetLinearVelocity(body_id)) * PIXELS_PER_METER + fabsf(b2Body_GetAngularVelocity(body_id)) * square_size_px;
+}
+
+// scores the scratch world with the candidate at rest. After a simulation the rest transform and the motion come from the `piece` body;
+// the ranking pass passes a null piece and scores the landing transform against the untouched snapshot.
+static void score_placement(placement_worker *worker, placement_candidate *candidate, b2BodyId piece) {
+	const placement_search *search = worker->search;
+	const world_snapshot *snapshot = search->snapshot;
+	float square = search->square_size_px;
+	bool simulated = B2_IS_NON_NULL(piece);
+
+	memset(worker->line_hits, 0, sizeof(int) * search->line_count);
+	candidate->motion = 0.0f;
+	for (int i = 0; i < snapshot->body_count; ++i) {
+		const snapshot_body *body = &snapshot->bodies[i];
+		b2Transform transform = b2Body_GetTransform(worker->bodies[i]);
+		if (body->tetromino_kind >= 0) {
+			count_line_cells(worker, transform, body->tetromino_kind, body->cell_mask, body->square_size_px);
+		} else {
+			count_shape_cells(worker, transform, body);
+		}
+		if (simulated) {
+			candidate->motion += body_motion_px(worker->bodies[i], body->square_size_px);
+		}
+	}
+
+	if (simulated) {
+		candidate->rest = b2Body_GetTransform(piece);
+		candidate->motion += body_motion_px(piece, square);
+	}
+	count_line_cells(worker, candidate->rest, candidate->kind, 0xF, square);
+
+	candidate->height = -INFINITY;
+	for (int cell = 0; cell < TETROMINO_CELL_COUNT; ++cell) {
+		float y = b2TransformPoint(candidate->rest, tetromino_cell_center(candidate->kind, cell, square)).y * PIXELS_PER_METER;
+		candidate->height = fmaxf(candidate->height, y + square * 0.5f);
+	}
+	candidate->lost = candidate->rest.p.y * PIXELS_PER_METER < search->lowest_line_y - 2.0f * square;
+
+	candidate->lines = 0;
+	for (int l = 0; l < search->line_count; ++l) {
+		candidate->lines += worker->line_hits[l] >= search->min_hits;
+	}
+	candidate->score = candidate->lines * PLACEMENT_LINE_WEIGHT - candidate->height / square * PLACEMENT_HEIGHT_WEIGHT -
+					   candidate->motion / square * PLACEMENT_MOTION_WEIGHT - (candidate->lost ? PLACEMENT_LOST_PENALTY : 0.0f);
+}
+
+static int compare_candidates_by_score(const void *a, const void *b) {
+	const placement_candidate *ca = (const placement_candidate *)a;
+	const placement_candidate *cb = (const placement_candidate *)b;
+	if (ca->evaluated != cb->evaluated)
+		return ca->evaluated ? -1 : 1;
+	return (ca->score < cb->score) - (ca->score > cb->score);
+}
+
+static void clear_scratch_world(placement_worker *worker) {
+	for (int i = 0; i < worker->search->snapshot->body_count; ++i) {
+		b2DestroyBody(worker->bodies[i]);
+	}
+}
+
+// casts the candidate straight down onto the (filled) scratch world; sets where it lands (rest) and where its simulation starts (drop)
+static void land_placement(placement_worker *worker, placement_candidate *candidate) {
+	placement_search *search = worker->search;
+	float square = search->square_size_px;
+
+	b2Vec2 position = pixels_to_meters(candidate->x, search->spawn_y);
+	b2Rot rotation = b2MakeRot(candidate->angle * DEGTORAD);
+	b2Vec2 translation = {0.0f, -(search->spawn_y - search->lowest_line_y + 4.0f * square) / PIXELS_PER_METER};
+	landing_cast_context landing = {b2_nullBodyId, 1.0f};
+	for (int i = 0; i < TETROMINO_MAX_PROXIES && TETROMINO_PROXIES[candidate->kind][i]; ++i) {
+		b2Polygon poly = tetromino_mask_polygon(candidate->kind, TETROMINO_PROXIES[candidate->kind][i], square, 0.0f);
+		b2ShapeProxy proxy = b2MakeOffsetProxy(poly.vertices, poly.count, poly.radius, position, rotation);
+		b2World_CastShape(worker->world_id, &proxy, translation, placement_query_filter(), landing_cast_callback, &landing);
+	}
+
+	candidate->landed = landing.fraction < 1.0f;
+	candidate->rest = (b2Transform){{position.x, position.y + landing.fraction * translation.y}, rotation};
+	candidate->drop = (b2Vec2){candidate->rest.p.x, candidate->rest.p.y + PLACEMENT_DROP_GAP_PX / PIXELS_PER_METER};
+}
+
+// Cheap first pass (main thread, before the workers start): lands every candidate on the snapshot and scores it where it lands, then
+// sorts them so the full simulations go to the best PLACEMENT_SIMULATE_TOP candidates instead of whichever come first in the array.
+// Candidates with nothing to land on are lost and never simulated.
+static void rank_placements(placement_worker *worker) {
+	TRACE_SCOPE("rank_placements");
+	placement_search *search = worker->search;
+	fill_scratch_world(worker);
+	for (int i = 0; i < search->candidate_count; ++i) {
+		placement_candidate *candidate = &search->candidates[i];
+		land_placement(worker, candidate);
+		if (candidate->landed) {
+			score_placement(worker, candidate, b2_nullBodyId);
+		} else {
+			candidate->lost = true;
+			candidate->score = -PLACEMENT_LOST_PENALTY;
+		}
+	}
+	clear_scratch_world(worker);
+
+	qsort(search->candidates, search->candidate_count, sizeof(placement_candidate), compare_candidates_by_score);
+	search->simulate_count = 0;
+	while (search->simulate_count < search->candidate_count && search->simulate_count < PLACEMENT_SIMULATE_TOP &&
+		   search->candidates[search->simulate_count].landed) {
+		search->simulate_count++;
+	}
+}
+
+// drops the (landed) candidate onto the snapshot, simulates it for the search's number of steps and scores the result. Returns false
+// (candidate left unevaluated) when the deadline passes mid-simulation.
+static bool evaluate_placement(placement_worker *worker, placement_candidate *candidate) {
+	placement_search *search = worker->search;
+	fill_scratch_world(worker);
+
+	b2BodyDef bodyDef = dynamic_body_def();
+	bodyDef.position = candidate->drop;
+	bodyDef.rotation = candidate->rest.q;
+	b2BodyId piece = b2CreateBody(worker->world_id, &bodyDef);
+	create_tetromino_shapes(piece, candidate->kind, search->square_size_px, search->density, search->friction, search->restitution, true);
+
+	bool finished = true;
+	for (int step = 0; step < search->steps && finished; ++step) {
+		b2World_Step(worker->world_id, PLACEMENT_DT, PLACEMENT_SUBSTEPS);
+		finished = trace_now_us() < search->deadline_us && !atomic_load(&search->cancelled);
+	}
+	if (finished) {
+		score_placement(worker, candidate, piece);
+	}
+	b2DestroyBody(piece);
+	clear_scratch_world(worker);
+
+	candidate->evaluated = finished;
+	return finished;
+}
+
+static void *placement_worker_run(void *arg) {
+	placement_worker *worker = (placement_worker *)arg;
+	placement_search *search = worker->search;
+	trace_tid = 2 + worker->index;
+	for (;;) {
+		int i = atomic_fetch_add(&search->next, 1);
+		if (i >= search->simulate_count || trace_now_us() >= search->deadline_us || atomic_load(&search->cancelled))
+			break;
+		TRACE_SCOPE("placement_candidate");
+		evaluate_placement(worker, &search->candidates[i]);
+	}
+	return NULL;
+}
+
+// creates the worker's scratch world and buffers; on the main thread, Box2D world creation isn't thread safe
+static void init_placement_worker(mrb_state *mrb, placement_worker *worker, placement_search *search, int index,
+								  const b2WorldDef *worldDef) {
+	int body_count = search->snapshot->body_count;
+	*worker = (placement_worker){search, index, b2CreateWorld(worldDef)};
+	worker->bodies = tracked_malloc(mrb, sizeof(b2BodyId) * (body_count ? body_count : 1), MEM_SCRATCH);
+	worker->line_hits = tracked_malloc(mrb, sizeof(int) * search->line_count, MEM_SCRATCH);
+}
+
+// worker threads for a search; `background` searches leave a core to the game, blocking ones run worker 0 on the calling thread
+static int placement_thread_count(int candidate_count, bool background) {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	long cores = (long)info.dwNumberOfProcessors;
+#else
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	if (background) {
+		cores--;
+	}
+	int count = cores < 1 ? 1 : (cores > PLACEMENT_MAX_THREADS ? PLACEMENT_MAX_THREADS : (int)cores);
+	return count < candidate_count ? count : (candidate_count > 0 ? candidate_count : 1);
+}
+
+// what the last finished search did, see placement_stats
+typedef struct {
+	int candidates;
+	int simulated; // ranked high enough to be simulated
+	int evaluated; // simulated within the budget
+	float ms;
+} placement_stats_t;
+
+static placement_stats_t placement_stats = {0};
+
+// a prepared search and everything its workers use, so it can outlive the Ruby call that started it (start_placement_search)
+typedef struct {
+	placement_search search;
+	world_snapshot snapshot;
+	placement_worker workers[PLACEMENT_MAX_THREADS];
+	pthread_t threads[PLACEMENT_MAX_THREADS];
+	bool started[PLACEMENT_MAX_THREADS];
+	int thread_count;
+	uint64_t start_us;
+	int max_results;
+} placement_job;
+
+// the search started by start_placement_search, until placement_search_result collects it
+static placement_job *pending_placement_job = NULL;
+static bool placement_search_cancelled = false; // placement_search_result owes an empty result
+
+static void *placement_thread_main(void *arg) {
+	placement_worker *worker = (placement_worker *)arg;
+	placement_worker_run(worker);
+	atomic_fetch_sub(&worker->search->running, 1);
+	return NULL;
+}
+
+#define PACKED_CANDIDATE_STRIDE 3
+
+// Reads the search_placements arguments and does everything that has to happen on the main thread: snapshot, ranking pass and the
+// scratch worlds. Returns NULL (after a warning) for bad arguments.
+static placement_job *prepare_placement_job(mrb_state *mrb, mrb_value self, bool background) {
+	b2WorldId *worldId = DATA_PTR(self);
+	mrb_value candidates_ary, material, line_ys_ary;
+	mrb_float square_size_px, spawn_y;
+	mrb_int min_hits = 6;
+	mrb_float budget_ms = 12.0;
+	mrb_float seconds = 1.0;
+	mrb_int max_results = 5;
+	drb_api->mrb_get_args(mrb, "AAffA|iffi", &candidates_ary, &material, &square_size_px, &spawn_y, &line_ys_ary, &min_hits, &budget_ms,
+						  &seconds, &max_results);
+
+	mrb_int length = RARRAY_LEN(candidates_ary);
+	mrb_int line_count = RARRAY_LEN(line_ys_ary);
+	if (length % PACKED_CANDIDATE_STRIDE != 0 || RARRAY_LEN(material) < 3 || line_count == 0) {
+		printf("[CExt] -- WARNING: search_placements expects [kind, x, angle] candidates, a material triple and at least one line\n");
+		return NULL;
 	}
 
-	float avg_y = total_y / candidate_count;
-	line_hit *aligned_hits = drb_api->mrb_malloc(mrb, sizeof(line_hit) * candidate_count);
-	int aligned_count = 0;
-	for (int i = 0; i < candidate_count; ++i) {
-		if (fabs(candidates[i].world_pos_pixels.y - avg_y) < vertical_tolerance) {
-			aligned_hits[aligned_count++] = candidates[i];
+	placement_job *job = tracked_malloc(mrb, sizeof(placement_job), MEM_SCRATCH);
+	memset(job, 0, sizeof(placement_job));
+	job->start_us = trace_now_us();
+	job->max_results = (int)max_results;
+
+	placement_search *search = &job->search;
+	search->deadline_us = job->start_us + (uint64_t)(budget_ms * 1000.0);
+	search->density = drb_api->mrb_to_flo(mrb, drb_api->mrb_ary_entry(material, 0));
+	search->friction = drb_api->mrb_to_flo(mrb, drb_api->mrb_ary_entry(material, 1));
+	search->restitution = drb_api->mrb_to_flo(mrb, drb_api->mrb_ary_entry(material, 2));
+	search->square_size_px = square_size_px;
+	search->spawn_y = spawn_y;
+	search->min_hits = (int)min_hits;
+	search->steps = (int)ceilf(seconds / PLACEMENT_DT);
+
+	float *line_ys = tracked_malloc(mrb, sizeof(float) * line_count, MEM_SCRATCH);
+	search->lowest_line_y = INFINITY;
+	for (mrb_int i = 0; i < line_count; ++i) {
+		line_ys[i] = drb_api->mrb_to_flo(mrb, drb_api->mrb_ary_entry(line_ys_ary, i));
+		search->lowest_line_y = fminf(search->lowest_line_y, line_ys[i]);
+	}
+	search->line_ys = line_ys;
+	search->line_count = (int)line_count;
+
+	placement_candidate *candidates = tracked_malloc(mrb, sizeof(placement_candidate) * (length ? length : 1), MEM_SCRATCH);
+	for (mrb_int r = 0; r < length; r += PACKED_CANDIDATE_STRIDE) {
+		int kind = (int)drb_api->mrb_to_flo(mrb, drb_api->mrb_ary_entry(candidates_ary, r));
+		if (kind < 0 || kind >= TETROMINO_KIND_COUNT) {
+			printf("[CExt] -- WARNING: search_placements skipped candidate %d (kind %d)\n", (int)(r / PACKED_CANDIDATE_STRIDE), kind);
+			continue;
 		}
+		candidates[search->candidate_count++] = (placement_candidate){
+			.kind = kind,
+			.x = drb_api->mrb_to_flo(mrb, drb_api->mrb_ary_entry(candidates_ary, r + 1)),
+			.angle = drb_api->mrb_to_flo(mrb, drb_api->mrb_ary_entry(candidates_ary, r + 2)),
+		};
 	}
-	drb_api->mrb_free(mrb, candidates);
-
-	if (aligned_count < min_hits) {
-		drb_api->mrb_free(mrb, aligned_hits);
-		return results;
+	search->candidates = candidates;
+
+	take_world_snapshot(mrb, *worldId, &job->snapshot);
+	search->snapshot = &job->snapshot;
+
+	b2WorldDef worldDef = mainWorldDef;
+	worldDef.gravity = b2World_GetGravity(*worldId);
+	// worker 0 ranks the candidates first, the other workers are only needed for the ones that get simulated
+	init_placement_worker(mrb, &job->workers[0], search, 0, &worldDef);
+	rank_placements(&job->workers[0]);
+	job->thread_count = placement_thread_count(search->simulate_count, background);
+	for (int t = 1; t < job->thread_count; ++t) {
+		init_placement_worker(mrb, &job->workers[t], search, t, &worldDef);
 	}
+	return job;
+}
 
-	// TODO: Does Box2D give any guarantees on hit order - meaning is this necessary?
-	qsort(aligned_hits, aligned_count, sizeof(line_hit), compare_hits_by_x);
-
-	line_hit *largest_group = NULL;
-	int max_group_size = 0;
-	int current_group_start = 0;
-	// find largest group, i.e. biggest grouping of vertically aligned shapes within horizontal limits
-	for (int i = 1; i <= aligned_count; ++i) {
-		// A group ends if we reach the end of the array OR the next shape is too far away
-		if (i == aligned_count || aligned_hits[i].world_pos_pixels.x - aligned_hits[i - 1].world_pos_pixels.x > horizontal_tolerance) {
-			int current_group_size = i - current_group_start;
-			if (current_group_size > max_group_size) {
-				max_group_size = current_group_size;
-				largest_group = &aligned_hits[current_group_start];
-			}
-			current_group_start = i;
+// Starts the job's worker threads. A blocking job (or one whose threads all fail to start) runs worker 0 on the calling thread; if a
+// thread can't be started its share is simply picked up by the others.
+static void launch_placement_job(placement_job *job, bool background) {
+	bool any_started = false;
+	for (int t = background ? 0 : 1; t < job->thread_count; ++t) {
+		atomic_fetch_add(&job->search.running, 1);
+		job->started[t] = pthread_create(&job->threads[t], NULL, placement_thread_main, &job->workers[t]) == 0;
+		if (!job->started[t]) {
+			atomic_fetch_sub(&job->search.running, 1);
 		}
+		any_started = any_started || job->started[t];
 	}
+	if (!background || !any_started) {
+		placement_worker_run(&job->workers[0]);
+		trace_tid = 1;
+	}
+}
 
-	// we can now assume the 'largest group' constitues an approximation of a horizontal line -> destroy the shapes it has and return the
-	// list of affected bodies from it
-	if (max_group_size >= min_hits) {
-		mrb_value bodies_to_split_ary =
-			drb_api->mrb_hash_get(mrb, results, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "bodies_to_split")));
-		mrb_value cleared_points_ary =
-			drb_api->mrb_hash_get(mrb, results, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "cleared_points")));
-
-		b2BodyId *unique_bodies = drb_api->mrb_malloc(mrb, sizeof(b2BodyId) * max_group_size);
-		int unique_body_count = 0;
+// Joins the job's threads (they stop at the deadline at the latest) and frees everything but the candidates and the job itself. Doesn't
+// touch mruby, so it can run from a GC free function. Updates placement_stats.
+static void join_placement_job(mrb_state *mrb, placement_job *job) {
+	placement_search *search = &job->search;
+	for (int t = 0; t < job->thread_count; ++t) {
+		if (job->started[t]) {
+			pthread_join(job->threads[t], NULL);
+		}
+		b2DestroyWorld(job->workers[t].world_id);
+		tracked_free(mrb, job->workers[t].bodies);
+		tracked_free(mrb, job->workers[t].line_hits);
+	}
+	free_world_snapshot(mrb, &job->snapshot);
+	tracked_free(mrb, (void *)search->line_ys);
 
-		for (int i = 0; i < max_group_size; ++i) {
-			line_hit hit = largest_group[i];
-			b2BodyId body_id = b2Shape_GetBody(hit.shape_id);
+	placement_stats = (placement_stats_t){search->candidate_count, search->simulate_count, 0, (trace_now_us() - job->start_us) / 1000.0f};
+	for (int i = 0; i < search->simulate_count; ++i) {
+		placement_stats.evaluated += search->candidates[i].evaluated;
+	}
+}
 
-			bool found = false;
-			for (int j = 0; j < unique_body_count; j++) {
-				if (unique_bodies[j].index1 == body_id.index1) {
-					found = true;
-					break;
-				}
-			}
-			if (!found) {
-				unique_bodies[unique_body_count++] = body_id;
-			}
+// Joins the job, frees it and returns the best `max_results` evaluated candidates as hashes, best first
+static mrb_value finish_placement_job(mrb_state *mrb, placement_job *job) {
+	placement_search *search = &job->search;
+	join_placement_job(mrb, job);
+
+	placement_candidate *candidates = search->candidates;
+	qsort(candidates, search->simulate_count, sizeof(placement_candidate), compare_candidates_by_score);
+	mrb_value results = drb_api->mrb_ary_new_capa(mrb, job->max_results);
+	for (int i = 0; i < search->candidate_count && i < job->max_results && candidates[i].evaluated; ++i) {
+		placement_candidate *c = &candidates[i];
+		b2Vec2 rest = meters_to_pixels(c->rest.p.x, c->rest.p.y);
+		mrb_value hash = drb_api->mrb_hash_new(mrb);
+		drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "kind")),
+							  drb_api->mrb_int_value(mrb, c->kind));
+		drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "x")), drb_api->mrb_float_value(mrb, c->x));
+		drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "angle")),
+							  drb_api->mrb_float_value(mrb, c->angle));
+		drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "score")),
+							  drb_api->mrb_float_value(mrb, c->score));
+		drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "lines")),
+							  drb_api->mrb_int_value(mrb, c->lines));
+		drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "height")),
+							  drb_api->mrb_float_value(mrb, c->height));
+		drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "motion")),
+							  drb_api->mrb_float_value(mrb, c->motion));
+		drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "lost")), mrb_bool_value(c->lost));
+		drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "rest_x")),
+							  drb_api->mrb_float_value(mrb, rest.x));
+		drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "rest_y")),
+							  drb_api->mrb_float_value(mrb, rest.y));
+		drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "rest_angle")),
+							  drb_api->mrb_float_value(mrb, b2Rot_GetAngle(c->rest.q) * RAD2DEG));
+		drb_api->mrb_ary_push(mrb, results, hash);
+	}
+	tracked_free(mrb, candidates);
+	tracked_free(mrb, job);
+	return results;
+}
 
-			// Add the shape's position to the return data for visual effects
-			mrb_value hit_hash = drb_api->mrb_hash_new(mrb);
-			drb_api->mrb_hash_set(mrb, hit_hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "x")),
-								  drb_api->mrb_float_value(mrb, hit.world_pos_pixels.x));
-			drb_api->mrb_hash_set(mrb, hit_hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "y")),
-								  drb_api->mrb_float_value(mrb, hit.world_pos_pixels.y));
-			drb_api->mrb_ary_push(mrb, cleared_points_ary, hit_hash);
+// search_placements(candidates, material, square_size, spawn_y, line_ys, min_hits = 6, budget_ms = 12, seconds = 1.0, max_results = 5)
+// - simulates every candidate drop of the flat `candidates` array [kind, x, angle, ...] (kind indexes "t o l j i s z", x in pixels, angle
+// in degrees) for `seconds` on all cores, without the controlled piece, and returns the best `max_results` as hashes
+// { kind:, x:, angle:, score:, lines:, height:, motion:, lost:, rest_x:, rest_y:, rest_angle: }, best first. `material` is
+// [density, friction, restitution] of the dropped piece, `line_ys` are the line centers (pixels) that count towards lines with `min_hits`
+// cells. The candidates are ranked by where a straight drop lands them first, only the best PLACEMENT_SIMULATE_TOP are simulated and
+// the ones that don't finish within `budget_ms` are left out; placement_stats tells how many made it. Blocks for up to `budget_ms`, the
+// game uses start_placement_search instead.
+static mrb_value world_search_placements(mrb_state *mrb, mrb_value self) {
+	TRACE_SCOPE("search_placements");
+	placement_job *job = prepare_placement_job(mrb, self, false);
+	if (!job) {
+		return mrb_nil_value();
+	}
+	launch_placement_job(job, false);
+	return finish_placement_job(mrb, job);
+}
 
-			b2DestroyShape(hit.shape_id, true);
-		}
+// Stops the background search (if any) and frees it. Box2D's world registry isn't thread safe, so this runs before any world is created
+// or destroyed outside the search (World.new, a World's GC) while the workers still create and destroy bodies in their scratch worlds.
+static void cancel_placement_search(mrb_state *mrb) {
+	if (!pending_placement_job) {
+		return;
+	}
+	atomic_store(&pending_placement_job->search.cancelled, true);
+	join_placement_job(mrb, pending_placement_job);
+	tracked_free(mrb, pending_placement_job->search.candidates);
+	tracked_free(mrb, pending_placement_job);
+	pending_placement_job = NULL;
+	placement_search_cancelled = true;
+}
 
-		// Second, populate the Ruby array with the affected body objects
-		for (int i = 0; i < unique_body_count; i++) {
-			b2BodyId body_id = unique_bodies[i];
-			if (b2Body_IsValid(body_id)) {
-				body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
-				if (buc && !mrb_nil_p(buc->body_obj)) {
-					drb_api->mrb_ary_push(mrb, bodies_to_split_ary, buc->body_obj);
-				}
-			}
-		}
-		drb_api->mrb_free(mrb, unique_bodies);
+// start_placement_search(same arguments as search_placements) - prepares the search on the main thread (snapshot, ranking pass and
+// scratch worlds) and simulates in the background; collect it with placement_search_result on a later frame. The workers only touch
+// their scratch worlds, so the live world can be stepped meanwhile. A search that is still running is cancelled.
+static mrb_value world_start_placement_search(mrb_state *mrb, mrb_value self) {
+	TRACE_SCOPE("start_placement_search");
+	cancel_placement_search(mrb);
+	placement_search_cancelled = false;
+	placement_job *job = prepare_placement_job(mrb, self, true);
+	if (!job) {
+		return mrb_nil_value();
 	}
+	launch_placement_job(job, true);
+	pending_placement_job = job;
+	return mrb_true_value();
+}
 
-	drb_api->mrb_free(mrb, aligned_hits);
+// placement_search_result - nil while the search started by start_placement_search is still running (or none was started), afterwards
+// its results as returned by search_placements, once. A search cancelled by a world being created or freed gives an empty array.
+static mrb_value world_placement_search_result(mrb_state *mrb, mrb_value self) {
+	if (placement_search_cancelled) {
+		placement_search_cancelled = false;
+		return drb_api->mrb_ary_new(mrb);
+	}
+	if (!pending_placement_job || atomic_load(&pending_placement_job->search.running) > 0) {
+		return mrb_nil_value();
+	}
+	mrb_value results = finish_placement_job(mrb, pending_placement_job);
+	pending_placement_job = NULL;
 	return results;
 }
 
-static mrb_value world_step(mrb_state *mrb, mrb_value self) {
-	b2WorldId *worldId = DATA_PTR(self);
+// placement_stats - { candidates:, simulated:, evaluated:, ms: } of the last search_placements: how many candidates were passed in, how
+// many ranked high enough to be simulated and how many of those finished within the budget
+static mrb_value world_placement_stats(mrb_state *mrb, mrb_value self) {
+	mrb_value hash = drb_api->mrb_hash_new(mrb);
+	drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "candidates")),
+						  drb_api->mrb_int_value(mrb, placement_stats.candidates));
+	drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "simulated")),
+						  drb_api->mrb_int_value(mrb, placement_stats.simulated));
+	drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "evaluated")),
+						  drb_api->mrb_int_value(mrb, placement_stats.evaluated));
+	drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "ms")),
+						  drb_api->mrb_float_value(mrb, placement_stats.ms));
+	return hash;
+}
 
-	float dt = get_delta_time();
-	b2World_Step(*worldId, dt, 8);
+// b2World_Step timings (from the Box2D profile), used to compare build configurations - see pre-native.sh --bench
+typedef struct {
+	int steps;
+	double total_ms;
+	float max_ms;
+} step_profile_t;
+
+static step_profile_t step_profile = {0};
+
+// Active piece controller: Body#control sets a target velocity and a target spin rate (or a target angle) once. The body is tied to a
+// shapeless kinematic anchor with a b2MotorJoint; every frame the anchor is put back onto the body (rotated to the target angle when one
+// is held) and given the target velocities. Box2D solves the joint on every one of its sub-steps, so the body tracks the targets within
+// the frame with a bounded force, independent of the frame rate and without Ruby pushing impulses.
+#define BOX2D_SUBSTEPS 8
+#define CONTROL_MAX_ACCELERATION 80.0f		   // m/s^2, the most the joint may accelerate the body, gravity included
+#define CONTROL_MAX_ANGULAR_ACCELERATION 60.0f // rad/s^2
+#define CONTROL_CORRECTION 0.3f				   // motor joint position correction factor (0..1)
+
+static void update_body_controllers(b2WorldId world_id) {
+	for (int i = 0; i < controlled_bodies.count; ++i) {
+		b2BodyId body_id = controlled_bodies.ids[i];
+		if (body_id.world0 != world_id.index1 - 1 || !b2Body_IsValid(body_id))
+			continue;
+		body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+		if (!buc || !buc->controlled || buc->frozen || !b2Joint_IsValid(buc->control_joint))
+			continue;
+
+		b2Transform transform = b2Body_GetTransform(body_id);
+		b2Body_SetTransform(buc->control_anchor, transform.p, buc->hold_angle ? b2MakeRot(buc->target_angle) : transform.q);
+		b2Body_SetLinearVelocity(buc->control_anchor, buc->target_velocity);
+		b2Body_SetAngularVelocity(buc->control_anchor, buc->hold_angle ? 0.0f : buc->target_spin);
+		// cells may have been cleared since the last frame
+		b2MotorJoint_SetMaxForce(buc->control_joint, b2Body_GetMass(body_id) * CONTROL_MAX_ACCELERATION);
+		b2MotorJoint_SetMaxTorque(buc->control_joint, b2Body_GetRotationalInertia(body_id) * CONTROL_MAX_ANGULAR_ACCELERATION);
+	}
+}
 
-	b2SensorEvents sensorEvents = b2World_GetSensorEvents(*worldId);
+// sensor / contact / hit events of the latest b2World_Step
+static void process_step_events(mrb_state *mrb, b2WorldId world_id) {
+	TRACE_SCOPE("step_events");
+	b2SensorEvents sensorEvents = b2World_GetSensorEvents(world_id);
 	for (int i = 0; i < sensorEvents.beginCount; ++i) {
 		b2SensorBeginTouchEvent event = sensorEvents.beginEvents[i];
 		b2BodyId sensorBodyId = b2Shape_GetBody(event.sensorShapeId);
@@ -734,7 +2484,7 @@ static mrb_value world_step(mrb_state *mrb, mrb_value self) {
 		}
 	}
 
-	b2ContactEvents events = b2World_GetContactEvents(*worldId);
+	b2ContactEvents events = b2World_GetContactEvents(world_id);
 	for (int i = 0; i < events.beginCount; ++i) {
 		b2ContactBeginTouchEvent event = events.beginEvents[i];
 		b2BodyId bodyIdA = b2Shape_GetBody(event.shapeIdA);
@@ -749,22 +2499,335 @@ static mrb_value world_step(mrb_state *mrb, mrb_value self) {
 			holderB->collided = true;
 	}
 
+	if (freeze_settings.enabled) {
+		// hard impacts wake the frozen bodies around the impact point
+		for (int i = 0; i < events.hitCount; ++i) {
+			b2ContactHitEvent event = events.hitEvents[i];
+			if (event.approachSpeed < freeze_settings.impact_speed)
+				continue;
+			b2AABB around = {{event.point.x - FREEZE_THAW_MARGIN, event.point.y - FREEZE_THAW_MARGIN},
+							 {event.point.x + FREEZE_THAW_MARGIN, event.point.y + FREEZE_THAW_MARGIN}};
+			thaw_frozen_in_aabb(mrb, world_id, around);
+		}
+	}
+}
+
+// step(dt = 0) - advances the world by `dt` seconds, or by the (clamped) wall-clock time since the last step when dt <= 0
+static mrb_value world_step(mrb_state *mrb, mrb_value self) {
+	if (trace_enabled()) {
+		trace_record("frame", 'i');
+	}
+	TRACE_SCOPE("world_step");
+	b2WorldId *worldId = DATA_PTR(self);
+	mrb_float fixed_dt = 0.0f;
+	drb_api->mrb_get_args(mrb, "|f", &fixed_dt);
+
+	float dt = get_delta_time();
+	if (fixed_dt > 0.0f) {
+		dt = fixed_dt;
+	}
+
+	update_body_controllers(*worldId);
+	{
+		TRACE_SCOPE("b2World_Step");
+		b2World_Step(*worldId, dt, BOX2D_SUBSTEPS);
+	}
+	float step_ms = b2World_GetProfile(*worldId).step;
+	process_step_events(mrb, *worldId);
+
+	step_profile.steps++;
+	step_profile.total_ms += step_ms;
+	step_profile.max_ms = fmaxf(step_profile.max_ms, step_ms);
+
+	if (jitter_settings.enabled) {
+		update_jittering_bodies(mrb, *worldId, dt);
+	}
+
+	if (freeze_settings.enabled) {
+		update_frozen_bodies(*worldId, dt);
+	}
+
+	if (active_region.enabled) {
+		update_active_region(mrb, *worldId);
+	}
+
+	return mrb_nil_value();
+}
+
+// step_profile(reset = false) - returns { steps:, avg_ms:, max_ms: } for b2World_Step since the last reset
+static mrb_value world_step_profile(mrb_state *mrb, mrb_value self) {
+	mrb_bool reset = false;
+	drb_api->mrb_get_args(mrb, "|b", &reset);
+
+	double avg_ms = step_profile.steps > 0 ? step_profile.total_ms / step_profile.steps : 0.0;
+	mrb_value hash = drb_api->mrb_hash_new(mrb);
+	drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "steps")),
+						  drb_api->mrb_int_value(mrb, step_profile.steps));
+	drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "avg_ms")), drb_api->mrb_float_value(mrb, avg_ms));
+	drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "max_ms")),
+						  drb_api->mrb_float_value(mrb, step_profile.max_ms));
+
+	if (reset) {
+		step_profile = (step_profile_t){0};
+	}
+	return hash;
+}
+
+// memory_stats - returns { current:, peak:, categories: { box2d: { bytes:, count:, allocations: }, body_contexts: {...}, ... } } with the
+// live bytes and allocation counts (plus the total number of allocations made) of Box2D and of the extension's own allocations
+static mrb_value world_memory_stats(mrb_state *mrb, mrb_value self) {
+	mrb_value categories = drb_api->mrb_hash_new(mrb);
+	for (int i = 0; i < MEM_CATEGORY_COUNT; ++i) {
+		mrb_value category = drb_api->mrb_hash_new(mrb);
+		drb_api->mrb_hash_set(mrb, category, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "bytes")),
+							  drb_api->mrb_int_value(mrb, atomic_load(&mem_stats.bytes[i])));
+		drb_api->mrb_hash_set(mrb, category, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "count")),
+							  drb_api->mrb_int_value(mrb, atomic_load(&mem_stats.count[i])));
+		drb_api->mrb_hash_set(mrb, category, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "allocations")),
+							  drb_api->mrb_int_value(mrb, atomic_load(&mem_stats.allocations[i])));
+		drb_api->mrb_hash_set(mrb, categories, drb_api->mrb_symbol_value(drb_api->mrb_intern_cstr(mrb, MEM_CATEGORY_NAMES[i])), category);
+	}
+
+	mrb_value hash = drb_api->mrb_hash_new(mrb);
+	drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "current")),
+						  drb_api->mrb_int_value(mrb, atomic_load(&mem_stats.current)));
+	drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "peak")),
+						  drb_api->mrb_int_value(mrb, atomic_load(&mem_stats.peak)));
+	drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_lit(mrb, "categories")), categories);
+	return hash;
+}
+
+// trace(enabled) - starts (clearing the previous events) or stops recording trace events
+static mrb_value world_trace(mrb_state *mrb, mrb_value self) {
+	mrb_bool enabled;
+	drb_api->mrb_get_args(mrb, "b", &enabled);
+	if (enabled && !trace_enabled()) {
+		atomic_store(&trace.head, 0);
+	}
+	atomic_store(&trace.enabled, enabled);
+	return mrb_nil_value();
+}
+
+// trace_flush(path) - writes the recorded events as Chrome trace-event JSON, returns false if the file couldn't be written
+static mrb_value world_trace_flush(mrb_state *mrb, mrb_value self) {
+	char *path;
+	drb_api->mrb_get_args(mrb, "z", &path);
+	if (!trace_write_json(path)) {
+		printf("[CExt] -- WARNING: could not write trace to %s\n", path);
+		return mrb_false_value();
+	}
+	return mrb_true_value();
+}
+
+// trace_begin(name) / trace_end(name) - lets Ruby add its own phases (e.g. split_body) to the trace
+static mrb_value world_trace_begin(mrb_state *mrb, mrb_value self) {
+	char *name;
+	drb_api->mrb_get_args(mrb, "z", &name);
+	if (trace_enabled()) {
+		trace_record(trace_intern(name), 'B');
+	}
+	return mrb_nil_value();
+}
+
+static mrb_value world_trace_end(mrb_state *mrb, mrb_value self) {
+	char *name;
+	drb_api->mrb_get_args(mrb, "z", &name);
+	if (trace_enabled()) {
+		trace_record(trace_intern(name), 'E');
+	}
+	return mrb_nil_value();
+}
+
+// puff_particles(per_cell) - number of particles emitted for every cell cleared by raycast, 0 disables the effect
+static mrb_value world_puff_particles(mrb_state *mrb, mrb_value self) {
+	mrb_int per_cell;
+	drb_api->mrb_get_args(mrb, "i", &per_cell);
+	particles.per_cell = per_cell < 0 ? 0 : (int)per_cell;
+	return mrb_nil_value();
+}
+
+// rendering values of the live particles, rebuilt by every update_particles call
+static mrb_value particle_values[PARTICLE_CAPACITY * 4];
+
+// update_particles(dt = 1/60) - advances the puff particles and returns them as one flat array [x, y, size, alpha, x, y, ...] of whole
+// pixels with alpha in 0..255. The values are immediate integers written into a static buffer and handed over with a single call, so
+// nothing is allocated per particle.
+static mrb_value world_update_particles(mrb_state *mrb, mrb_value self) {
+	mrb_float dt = 1.0f / 60.0f;
+	drb_api->mrb_get_args(mrb, "|f", &dt);
+
+	integrate_particles(dt);
+	compact_particles();
+
+	mrb_value *out = particle_values;
+	for (int i = 0; i < particles.count; ++i) {
+		float t = particles.life[i] * particles.inv_life[i]; // 1 -> 0 over the lifetime
+		*out++ = mrb_fixnum_value((mrb_int)lrintf(particles.x[i]));
+		*out++ = mrb_fixnum_value((mrb_int)lrintf(particles.y[i]));
+		*out++ = mrb_fixnum_value((mrb_int)lrintf(PARTICLE_END_SIZE + (PARTICLE_START_SIZE - PARTICLE_END_SIZE) * t));
+		*out++ = mrb_fixnum_value((mrb_int)lrintf(255.0f * t));
+	}
+	return drb_api->mrb_ary_new_from_values(mrb, particles.count * 4, particle_values);
+}
+
+// freeze_settled(enabled, settle_seconds = 3.0, impact_speed = 3.0) - toggles freezing of long-settled bodies, impact_speed is in m/s.
+// Disabling thaws everything that is currently frozen.
+static mrb_value world_freeze_settled(mrb_state *mrb, mrb_value self) {
+	b2WorldId *worldId = DATA_PTR(self);
+	mrb_bool enabled;
+	mrb_float settle_seconds = 3.0f;
+	mrb_float impact_speed = 3.0f;
+	drb_api->mrb_get_args(mrb, "b|ff", &enabled, &settle_seconds, &impact_speed);
+
+	freeze_settings = (freeze_settings_t){enabled, settle_seconds, impact_speed};
+	if (!enabled) {
+		thaw_all_frozen(*worldId);
+	}
+	return mrb_nil_value();
+}
+
+static mrb_value world_frozen_count(mrb_state *mrb, mrb_value self) {
+	b2WorldId *worldId = DATA_PTR(self);
+	int count = 0;
+	for (int i = 0; i < tracked_bodies.count; ++i) {
+		b2BodyId body_id = tracked_bodies.ids[i];
+		if (body_id.world0 != worldId->index1 - 1 || !b2Body_IsValid(body_id))
+			continue;
+		body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+		if (buc && buc->frozen)
+			count++;
+	}
+	return drb_api->mrb_int_value(mrb, count);
+}
+
+// active_region(min_y, max_y, band = 160) - limits the simulation to the bodies around min_y..max_y (pixels), see update_active_region.
+// Cheap to call every frame, the region is applied at the end of the next step.
+static mrb_value world_active_region(mrb_state *mrb, mrb_value self) {
+	mrb_float min_y, max_y;
+	mrb_float band = 160.0f;
+	drb_api->mrb_get_args(mrb, "ff|f", &min_y, &max_y, &band);
+
+	if (max_y < min_y) {
+		printf("[CExt] -- WARNING: active_region max_y %f is below min_y %f\n", max_y, min_y);
+		return mrb_nil_value();
+	}
+	active_region.enabled = true;
+	active_region.min_y = min_y / PIXELS_PER_METER;
+	active_region.max_y = max_y / PIXELS_PER_METER;
+	active_region.band = band / PIXELS_PER_METER;
+	return mrb_nil_value();
+}
+
+// clear_active_region - puts every body back into the simulation
+static mrb_value world_clear_active_region(mrb_state *mrb, mrb_value self) {
+	b2WorldId *worldId = DATA_PTR(self);
+	release_active_region(mrb, *worldId);
+	return mrb_nil_value();
+}
+
+// Returns the top of the settled pile inside the active region in pixels, or nil if there is no region or nothing has settled
+static mrb_value world_tower_top(mrb_state *mrb, mrb_value self) {
+	if (!active_region.enabled || active_region.tower_top == -INFINITY) {
+		return mrb_nil_value();
+	}
+	return drb_api->mrb_float_value(mrb, active_region.tower_top * PIXELS_PER_METER);
+}
+
+// Returns the bodies overlapping the active region as of the last step (every dynamic body without a region), plus the ones created
+// since. Lets the game render and clean up only what is visible instead of asking every body ever placed.
+static mrb_value world_region_bodies(mrb_state *mrb, mrb_value self) {
+	b2WorldId *worldId = DATA_PTR(self);
+	mrb_value result = drb_api->mrb_ary_new(mrb);
+	for (int i = 0; i < region_bodies.count; ++i) {
+		b2BodyId body_id = region_bodies.ids[i];
+		if (body_id.world0 != worldId->index1 - 1 || !b2Body_IsValid(body_id))
+			continue;
+		body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+		if (buc && !mrb_nil_p(buc->body_obj)) {
+			drb_api->mrb_ary_push(mrb, result, buc->body_obj);
+		}
+	}
+	return result;
+}
+
+// Number of bodies currently disabled by the active region
+static mrb_value world_disabled_count(mrb_state *mrb, mrb_value self) { return drb_api->mrb_int_value(mrb, active_region.disabled_count); }
+
+// damp_jitter(enabled, jitter_seconds = 1.0) - toggles the jitter detector; disabling restores the damping of flagged bodies
+static mrb_value world_damp_jitter(mrb_state *mrb, mrb_value self) {
+	b2WorldId *worldId = DATA_PTR(self);
+	mrb_bool enabled;
+	mrb_float jitter_seconds = 1.0f;
+	drb_api->mrb_get_args(mrb, "b|f", &enabled, &jitter_seconds);
+
+	jitter_settings = (jitter_settings_t){enabled, jitter_seconds};
+	if (!enabled) {
+		for (int i = 0; i < tracked_bodies.count; ++i) {
+			b2BodyId body_id = tracked_bodies.ids[i];
+			if (body_id.world0 != worldId->index1 - 1 || !b2Body_IsValid(body_id))
+				continue;
+			body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+			if (buc) {
+				restore_jitter_damping(body_id, buc);
+			}
+		}
+	}
 	return mrb_nil_value();
 }
 
+// Returns the bodies currently flagged as jittering (i.e. running with extra damping)
+static mrb_value world_jittering_bodies(mrb_state *mrb, mrb_value self) {
+	b2WorldId *worldId = DATA_PTR(self);
+	mrb_value result = drb_api->mrb_ary_new(mrb);
+	for (int i = 0; i < tracked_bodies.count; ++i) {
+		b2BodyId body_id = tracked_bodies.ids[i];
+		if (body_id.world0 != worldId->index1 - 1 || !b2Body_IsValid(body_id))
+			continue;
+		body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+		if (buc && buc->damped && !mrb_nil_p(buc->body_obj)) {
+			drb_api->mrb_ary_push(mrb, result, buc->body_obj);
+		}
+	}
+	return result;
+}
+
+// true while the body is frozen as part of a settled pile; not named frozen? so Kernel#frozen? keeps meaning immutability
+static mrb_value body_is_settled_frozen(mrb_state *mrb, mrb_value self) {
+	b2BodyId *bodyId = DATA_PTR(self);
+	body_user_context *buc = (body_user_context *)b2Body_GetUserData(*bodyId);
+	return mrb_bool_value(buc && buc->frozen);
+}
+
+// true if the body overlaps the active region (always true without one); used to only render what is visible
+static mrb_value body_in_active_region(mrb_state *mrb, mrb_value self) {
+	b2BodyId *bodyId = DATA_PTR(self);
+	body_user_context *buc = (body_user_context *)b2Body_GetUserData(*bodyId);
+	return mrb_bool_value(!active_region.enabled || !buc || buc->controlled || buc->in_region);
+}
+
+// tag given to the body by create_bodies, 0 otherwise
+static mrb_value body_tag(mrb_state *mrb, mrb_value self) {
+	b2BodyId *bodyId = DATA_PTR(self);
+	body_user_context *buc = (body_user_context *)b2Body_GetUserData(*bodyId);
+	return drb_api->mrb_int_value(mrb, buc ? buc->tag : 0);
+}
+
 static mrb_value body_destroy(mrb_state *mrb, mrb_value self) {
+	TRACE_SCOPE("destroy_body");
 	b2BodyId *bodyId_ptr = DATA_PTR(self);
 	if (bodyId_ptr && b2Body_IsValid(*bodyId_ptr)) {
 		b2BodyId bodyId = *bodyId_ptr;
 		body_user_context *buc = (body_user_context *)b2Body_GetUserData(bodyId);
 		if (buc) {
-			drb_api->mrb_free(mrb, buc);
+			destroy_control_anchor(buc);
+			tracked_free(mrb, buc);
 		}
+		untrack_body(bodyId);
 		b2DestroyBody(bodyId);
 	}
 
 	if (bodyId_ptr) {
-		drb_api->mrb_free(mrb, bodyId_ptr);
+		tracked_free(mrb, bodyId_ptr);
 	}
 	DATA_PTR(self) = NULL;
 
@@ -883,14 +2946,36 @@ static mrb_value body_get_shapes_info(mrb_state *mrb, mrb_value self) {
 	}
 
 	// Allocate memory to hold the shape IDs
-	b2ShapeId *shapeIds = drb_api->mrb_malloc(mrb, sizeof(b2ShapeId) * shapeCount);
+	b2ShapeId *shapeIds = tracked_malloc(mrb, sizeof(b2ShapeId) * shapeCount, MEM_SCRATCH);
 	b2Body_GetShapes(*bodyId, shapeIds, shapeCount);
 
 	mrb_value result_array = drb_api->mrb_ary_new_capa(mrb, shapeCount);
 
+	body_user_context *buc = (body_user_context *)b2Body_GetUserData(*bodyId);
+
 	for (int i = 0; i < shapeCount; i++) {
 		b2ShapeId shapeId = shapeIds[i];
-		if (b2Shape_GetType(shapeId) == b2_polygonShape) {
+		uint8_t cell_mask = shape_cell_mask(shapeId);
+		if (b2Shape_GetType(shapeId) == b2_polygonShape && cell_mask_count(cell_mask) > 1 && buc && buc->tetromino_kind >= 0) {
+			// merged tetromino proxy: report its logical cells so rendering and splitting keep working per cell
+			for (int c = 0; c < TETROMINO_CELL_COUNT; ++c) {
+				if (!(cell_mask & (1u << c)))
+					continue;
+				b2Vec2 center_meters = tetromino_cell_center(buc->tetromino_kind, c, buc->square_size_px);
+
+				mrb_value hash = drb_api->mrb_hash_new(mrb);
+				drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_cstr(mrb, "x")),
+									  drb_api->mrb_float_value(mrb, center_meters.x * PIXELS_PER_METER));
+				drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_cstr(mrb, "y")),
+									  drb_api->mrb_float_value(mrb, center_meters.y * PIXELS_PER_METER));
+				drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_cstr(mrb, "w")),
+									  drb_api->mrb_float_value(mrb, buc->square_size_px));
+				drb_api->mrb_hash_set(mrb, hash, drb_api->mrb_symbol_value(drb_api->mrb_intern_cstr(mrb, "h")),
+									  drb_api->mrb_float_value(mrb, buc->square_size_px));
+
+				drb_api->mrb_ary_push(mrb, result_array, hash);
+			}
+		} else if (b2Shape_GetType(shapeId) == b2_polygonShape) {
 			b2Polygon polygon = b2Shape_GetPolygon(shapeId);
 
 			// The polygon's centroid is its center relative to the body's origin (in meters)
@@ -940,7 +3025,7 @@ static mrb_value body_get_shapes_info(mrb_state *mrb, mrb_value self) {
 		}
 	}
 
-	drb_api->mrb_free(mrb, shapeIds);
+	tracked_free(mrb, shapeIds);
 	return result_array;
 }
 
@@ -1021,35 +3106,225 @@ static mrb_value body_apply_impulse_for_velocity(mrb_state *mrb, mrb_value self)
 	return mrb_nil_value();
 }
 
-#define MAX_ROT_DEGREES 5 // TODO: this should be just up to the parameters to body_rotate -> move to Ruby
-
-// TODO: clean up this mess...
-static mrb_value body_rotate(mrb_state *mrb, mrb_value self) {
+// control(vx, vy, spin = 0, angle = nil) - hands the body to the native controller (see update_body_controllers): target velocity in m/s,
+// target spin in degrees per second, or with `angle` (degrees) the controller holds that angle instead of spinning. Only needs to be
+// called again when the targets change.
+static mrb_value body_control(mrb_state *mrb, mrb_value self) {
 	b2BodyId *bodyId = DATA_PTR(self);
-	b2Rot rotation = b2Body_GetRotation(*bodyId);
-	float angle_radians = b2Rot_GetAngle(rotation);
+	mrb_float vx, vy;
+	mrb_float spin_degrees = 0.0f;
+	mrb_value angle = mrb_nil_value();
+	drb_api->mrb_get_args(mrb, "ff|fo", &vx, &vy, &spin_degrees, &angle);
 
-	mrb_float delta_angle_degrees;
-	drb_api->mrb_get_args(mrb, "f", &delta_angle_degrees);
-	float delta_radians = delta_angle_degrees * (M_PI / 180.0f);
-	float next_angle = angle_radians + b2Body_GetAngularVelocity(*bodyId) / 60.0f;
-	float total_rotation = angle_radians + delta_radians - next_angle;
-
-	while (total_rotation < -180.0f * DEGTORAD)
-		total_rotation += 360.0f * DEGTORAD;
-	while (total_rotation > 180.0f * DEGTORAD)
-		total_rotation -= 360.0f * DEGTORAD;
-	float desiredAngularVelocity = total_rotation * 60;
-	float change = MAX_ROT_DEGREES * DEGTORAD;
-	desiredAngularVelocity = fminf(change, fmaxf(-change, desiredAngularVelocity));
-	float impulse = b2Body_GetRotationalInertia(*bodyId) * desiredAngularVelocity;
-	b2Body_ApplyAngularImpulse(*bodyId, impulse, true);
+	body_user_context *buc = (body_user_context *)b2Body_GetUserData(*bodyId);
+	if (!buc) {
+		printf("[CExt] -- WARNING: control called on a body without user context\n");
+		return mrb_nil_value();
+	}
+	buc->target_velocity = (b2Vec2){vx, vy};
+	buc->target_spin = spin_degrees * DEGTORAD;
+	buc->hold_angle = !mrb_nil_p(angle);
+	buc->target_angle = buc->hold_angle ? drb_api->mrb_to_flo(mrb, angle) * DEGTORAD : 0.0f;
+	if (!buc->controlled) {
+		b2BodyDef anchorDef = b2DefaultBodyDef();
+		anchorDef.type = b2_kinematicBody;
+		anchorDef.position = b2Body_GetPosition(*bodyId);
+		anchorDef.rotation = b2Body_GetRotation(*bodyId);
+		buc->control_anchor = b2CreateBody(b2Body_GetWorld(*bodyId), &anchorDef);
+
+		b2MotorJointDef jointDef = b2DefaultMotorJointDef();
+		jointDef.bodyIdA = buc->control_anchor;
+		jointDef.bodyIdB = *bodyId;
+		jointDef.maxForce = b2Body_GetMass(*bodyId) * CONTROL_MAX_ACCELERATION;
+		jointDef.maxTorque = b2Body_GetRotationalInertia(*bodyId) * CONTROL_MAX_ANGULAR_ACCELERATION;
+		jointDef.correctionFactor = CONTROL_CORRECTION;
+		buc->control_joint = b2CreateMotorJoint(b2Body_GetWorld(*bodyId), &jointDef);
+
+		buc->controlled = true;
+		body_id_list_push(mrb, &controlled_bodies, *bodyId);
+	}
+	return mrb_nil_value();
+}
 
+// release_control - stops the controller, the body keeps its current velocity
+static mrb_value body_release_control(mrb_state *mrb, mrb_value self) {
+	b2BodyId *bodyId = DATA_PTR(self);
+	body_user_context *buc = (body_user_context *)b2Body_GetUserData(*bodyId);
+	if (buc && buc->controlled) {
+		destroy_control_anchor(buc);
+		buc->controlled = false;
+		body_id_list_remove(&controlled_bodies, *bodyId);
+	}
 	return mrb_nil_value();
 }
 
+// contact graph queries: walks the touching contacts of bodies (b2Body_GetContactData) natively so that gameplay questions like "what
+// is this piece resting on" or "how tall is this pile" can be answered with a single FFI call
+
+#define FROZEN_CONTACT_MARGIN 0.02f // meters; Box2D's speculative distance, where dynamic contacts start to get manifold points
+
+static bool body_is_frozen_piece(b2BodyId body_id) {
+	body_user_context *buc = (body_user_context *)b2Body_GetUserData(body_id);
+	return buc && buc->frozen;
+}
+
+typedef struct {
+	mrb_state *mrb;
+	b2BodyId body_id;
+	bool frozen;
+	body_id_list *out;
+} static_neighbour_context;
+
+static bool static_neighbour_callback(b2ShapeId shape_id, void *user_data) {
+	static_neighbour_context *context = (static_neighbour_context *)user_data;
+	b2BodyId other = b2Shape_GetBody(shape_id);
+	// dynamic neighbours are in the contact data, and two plain static bodies (ground and walls) don't touch in the contact graph
+	if (b2Shape_IsSensor(shape_id) || B2_ID_EQUALS(other, context->body_id) || b2Body_GetType(other) != b2_staticBody ||
+		!(context->frozen || body_is_frozen_piece(other)) || body_id_list_contains(context->out, other)) {
+		return true;
+	}
+	body_id_list_push(context->mrb, context->out, other);
+	return true;
+}
+
+// Box2D keeps no contacts between two static bodies, so once settled pieces are frozen (see freeze_body) a frozen body's static
+// neighbours and the ground's frozen ones are found by overlapping the body's shapes, grown by FROZEN_CONTACT_MARGIN, with the world
+static void collect_static_neighbours(mrb_state *mrb, b2BodyId body_id, body_id_list *out) {
+	int shape_count = b2Body_GetShapeCount(body_id);
+	if (shape_count == 0) {
+		return;
+	}
+
+	b2ShapeId *shape_ids = tracked_malloc(mrb, sizeof(b2ShapeId) * shape_count, MEM_SCRATCH);
+	shape_count = b2Body_GetShapes(body_id, shape_ids, shape_count);
+	b2Transform transform = b2Body_GetTransform(body_id);
+	static_neighbour_context context = {mrb, body_id, body_is_frozen_piece(body_id), out};
+	b2QueryFilter filter = b2DefaultQueryFilter();
+	filter.categoryBits = UINT64_MAX;
+	filter.maskBits = UINT64_MAX;
+	for (int i = 0; i < shape_count; ++i) {
+		b2ShapeProxy proxy;
+		switch (b2Shape_GetType(shape_ids[i])) {
+		case b2_polygonShape: {
+			b2Polygon poly = b2Shape_GetPolygon(shape_ids[i]);
+			proxy = b2MakeOffsetProxy(poly.vertices, poly.count, poly.radius + FROZEN_CONTACT_MARGIN, transform.p, transform.q);
+			break;
+		}
+		case b2_segmentShape: {
+			b2Segment segment = b2Shape_GetSegment(shape_ids[i]);
+			proxy = b2MakeOffsetProxy(&segment.point1, 2, FROZEN_CONTACT_MARGIN, transform.p, transform.q);
+			break;
+		}
+		case b2_chainSegmentShape: {
+			b2Segment segment = b2Shape_GetChainSegment(shape_ids[i]).segment;
+			proxy = b2MakeOffsetProxy(&segment.point1, 2, FROZEN_CONTACT_MARGIN, transform.p, transform.q);
+			break;
+		}
+		default:
+			continue;
+		}
+		if (!b2Shape_IsSensor(shape_ids[i])) {
+			b2World_OverlapShape(b2Body_GetWorld(body_id), &proxy, filter, static_neighbour_callback, &context);
+		}
+	}
+	tracked_free(mrb, shape_ids);
+}
+
+// appends the bodies currently touching `body_id` to `out` (skipping ones already in it); sensors never generate contact data
+static void collect_touching_bodies(mrb_state *mrb, b2BodyId body_id, body_id_list *out) {
+	if (b2Body_GetType(body_id) == b2_staticBody) {
+		collect_static_neighbours(mrb, body_id, out);
+	}
+
+	int capacity = b2Body_GetContactCapacity(body_id);
+	if (capacity == 0) {
+		return;
+	}
+
+	b2ContactData *contacts = tracked_malloc(mrb, sizeof(b2ContactData) * capacity, MEM_SCRATCH);
+	int contact_count = b2Body_GetContactData(body_id, contacts, capacity);
+	for (int i = 0; i < contact_count; ++i) {
+		if (contacts[i].manifold.pointCount == 0)
+			continue;
+		b2BodyId body_a = b2Shape_GetBody(contacts[i].shapeIdA);
+		b2BodyId other = B2_ID_EQUALS(body_a, body_id) ? b2Shape_GetBody(contacts[i].shapeIdB) : body_a;
+		if (!body_id_list_contains(out, other)) {
+			body_id_list_push(mrb, out, other);
+		}
+	}
+	tracked_free(mrb, contacts);
+}
+
+// breadth-first flood over the contact graph starting from `seed`. Static bodies (ground) end the flood unless they are the seed, so
+// seeding from the ground returns the whole pile resting on it while seeding from a block doesn't leak through the ground to every
+// other pile. Static bodies are not included in the result; frozen pieces are static only to save solver work and count as dynamic.
+static void collect_connected_bodies(mrb_state *mrb, b2BodyId seed, body_id_list *out) {
+	body_id_list visited = {0};
+	body_id_list_push(mrb, &visited, seed);
+
+	for (int i = 0; i < visited.count; ++i) {
+		b2BodyId body_id = visited.ids[i];
+		bool is_ground = b2Body_GetType(body_id) == b2_staticBody && !body_is_frozen_piece(body_id);
+		if (is_ground && i > 0) {
+			continue;
+		}
+		if (!is_ground) {
+			body_id_list_push(mrb, out, body_id);
+		}
+		collect_touching_bodies(mrb, body_id, &visited);
+	}
+
+	body_id_list_free(mrb, &visited);
+}
+
+static mrb_value body_id_list_to_ruby(mrb_state *mrb, const body_id_list *list) {
+	mrb_value result = drb_api->mrb_ary_new_capa(mrb, list->count);
+	for (int i = 0; i < list->count; ++i) {
+		body_user_context *buc = (body_user_context *)b2Body_GetUserData(list->ids[i]);
+		if (buc && !mrb_nil_p(buc->body_obj)) {
+			drb_api->mrb_ary_push(mrb, result, buc->body_obj);
+		}
+	}
+	return result;
+}
+
+// Returns the bodies (including static ones, e.g. the ground) this body is currently touching
 static mrb_value body_get_contacts(mrb_state *mrb, mrb_value self) {
-	return drb_api->mrb_iv_get(mrb, self, drb_api->mrb_intern_lit(mrb, "@contacts"));
+	b2BodyId *bodyId = DATA_PTR(self);
+	body_id_list touching = {0};
+	collect_touching_bodies(mrb, *bodyId, &touching);
+	mrb_value result = body_id_list_to_ruby(mrb, &touching);
+	body_id_list_free(mrb, &touching);
+	return result;
+}
+
+// Returns every non-static body connected to this one through touching contacts, the body itself included when it's not static
+static mrb_value body_get_connected_bodies(mrb_state *mrb, mrb_value self) {
+	b2BodyId *bodyId = DATA_PTR(self);
+	body_id_list connected = {0};
+	collect_connected_bodies(mrb, *bodyId, &connected);
+	mrb_value result = body_id_list_to_ruby(mrb, &connected);
+	body_id_list_free(mrb, &connected);
+	return result;
+}
+
+// Returns the height in pixels (top of the highest minus bottom of the lowest body AABB) of the stack connected to this body, 0 if empty
+static mrb_value body_get_stack_height(mrb_state *mrb, mrb_value self) {
+	b2BodyId *bodyId = DATA_PTR(self);
+	body_id_list connected = {0};
+	collect_connected_bodies(mrb, *bodyId, &connected);
+
+	float min_y = INFINITY;
+	float max_y = -INFINITY;
+	for (int i = 0; i < connected.count; ++i) {
+		b2AABB aabb = b2Body_ComputeAABB(connected.ids[i]);
+		min_y = fminf(min_y, aabb.lowerBound.y);
+		max_y = fmaxf(max_y, aabb.upperBound.y);
+	}
+	float height = connected.count > 0 ? (max_y - min_y) * PIXELS_PER_METER : 0.0f;
+	body_id_list_free(mrb, &connected);
+
+	return drb_api->mrb_float_value(mrb, height);
 }
 
 static mrb_value body_get_sensor_contact_count(mrb_state *mrb, mrb_value self) {
@@ -1065,6 +3340,8 @@ DRB_FFI_EXPORT
 void drb_register_c_extensions_with_api(mrb_state *state, struct drb_api_t *api) {
 	// Boilerplate and module definitions
 	drb_api = api;
+	// before any world exists, so every Box2D allocation is accounted for
+	b2SetAllocator(box2d_alloc, box2d_free);
 	struct RClass *FFI = drb_api->mrb_module_get(state, "FFI");
 	struct RClass *module = drb_api->mrb_define_module_under(state, FFI, "Box2D");
 	struct RClass *base = state->object_class;
@@ -1072,20 +3349,46 @@ void drb_register_c_extensions_with_api(mrb_state *state, struct drb_api_t *api)
 	struct RClass *World = drb_api->mrb_define_class_under(state, module, "World", base);
 	drb_api->mrb_define_method(state, World, "initialize", world_initialize, MRB_ARGS_NONE());
 	drb_api->mrb_define_method(state, World, "create_body", world_create_body, MRB_ARGS_ARG(3, 4));
-	drb_api->mrb_define_method(state, World, "step", world_step, MRB_ARGS_NONE());
+	drb_api->mrb_define_method(state, World, "step", world_step, MRB_ARGS_OPT(1));
+	drb_api->mrb_define_method(state, World, "step_profile", world_step_profile, MRB_ARGS_OPT(1));
+	drb_api->mrb_define_method(state, World, "memory_stats", world_memory_stats, MRB_ARGS_NONE());
+	drb_api->mrb_define_method(state, World, "trace", world_trace, MRB_ARGS_REQ(1));
+	drb_api->mrb_define_method(state, World, "trace_flush", world_trace_flush, MRB_ARGS_REQ(1));
+	drb_api->mrb_define_method(state, World, "trace_begin", world_trace_begin, MRB_ARGS_REQ(1));
+	drb_api->mrb_define_method(state, World, "trace_end", world_trace_end, MRB_ARGS_REQ(1));
+	drb_api->mrb_define_method(state, World, "puff_particles", world_puff_particles, MRB_ARGS_REQ(1));
+	drb_api->mrb_define_method(state, World, "update_particles", world_update_particles, MRB_ARGS_OPT(1));
 	drb_api->mrb_define_method(state, World, "raycast", world_raycast, MRB_ARGS_ARG(4, 3));
+	drb_api->mrb_define_method(state, World, "scan_lines", world_scan_lines, MRB_ARGS_ARG(3, 3));
+	drb_api->mrb_define_method(state, World, "create_bodies", world_create_bodies, MRB_ARGS_ARG(3, 1));
+	drb_api->mrb_define_method(state, World, "search_placements", world_search_placements, MRB_ARGS_ARG(5, 4));
+	drb_api->mrb_define_method(state, World, "start_placement_search", world_start_placement_search, MRB_ARGS_ARG(5, 4));
+	drb_api->mrb_define_method(state, World, "placement_search_result", world_placement_search_result, MRB_ARGS_NONE());
+	drb_api->mrb_define_method(state, World, "placement_stats", world_placement_stats, MRB_ARGS_NONE());
+	drb_api->mrb_define_method(state, World, "can_place", world_can_place, MRB_ARGS_ARG(4, 1));
+	drb_api->mrb_define_method(state, World, "predict_landing", world_predict_landing, MRB_ARGS_ARG(1, 1));
+	drb_api->mrb_define_method(state, World, "freeze_settled", world_freeze_settled, MRB_ARGS_ARG(1, 2));
+	drb_api->mrb_define_method(state, World, "frozen_count", world_frozen_count, MRB_ARGS_NONE());
+	drb_api->mrb_define_method(state, World, "damp_jitter", world_damp_jitter, MRB_ARGS_ARG(1, 1));
+	drb_api->mrb_define_method(state, World, "active_region", world_active_region, MRB_ARGS_ARG(2, 1));
+	drb_api->mrb_define_method(state, World, "clear_active_region", world_clear_active_region, MRB_ARGS_NONE());
+	drb_api->mrb_define_method(state, World, "region_bodies", world_region_bodies, MRB_ARGS_NONE());
+	drb_api->mrb_define_method(state, World, "tower_top", world_tower_top, MRB_ARGS_NONE());
+	drb_api->mrb_define_method(state, World, "disabled_count", world_disabled_count, MRB_ARGS_NONE());
+	drb_api->mrb_define_method(state, World, "jittering_bodies", world_jittering_bodies, MRB_ARGS_NONE());
 
 	// Body Ruby class definition
 	struct RClass *Body = drb_api->mrb_define_class_under(state, module, "Body", base);
+	body_class = Body;
 	drb_api->mrb_define_method(state, Body, "create_box_shape", body_create_box_shape, MRB_ARGS_ARG(3, 3));
 	drb_api->mrb_define_method(state, Body, "create_sensor_box", body_create_sensor_box, MRB_ARGS_REQ(2));
-	drb_api->mrb_define_method(state, Body, "create_t_shape", body_create_t_shape, MRB_ARGS_ARG(2, 2));
-	drb_api->mrb_define_method(state, Body, "create_box_shape_2x2", body_create_box_shape_2x2, MRB_ARGS_ARG(2, 2));
-	drb_api->mrb_define_method(state, Body, "create_l_shape", body_create_l_shape, MRB_ARGS_ARG(2, 2));
-	drb_api->mrb_define_method(state, Body, "create_j_shape", body_create_j_shape, MRB_ARGS_ARG(2, 2));
-	drb_api->mrb_define_method(state, Body, "create_i_shape", body_create_i_shape, MRB_ARGS_ARG(2, 2));
-	drb_api->mrb_define_method(state, Body, "create_s_shape", body_create_s_shape, MRB_ARGS_ARG(2, 2));
-	drb_api->mrb_define_method(state, Body, "create_z_shape", body_create_z_shape, MRB_ARGS_ARG(2, 2));
+	drb_api->mrb_define_method(state, Body, "create_t_shape", body_create_t_shape, MRB_ARGS_ARG(2, 3));
+	drb_api->mrb_define_method(state, Body, "create_box_shape_2x2", body_create_box_shape_2x2, MRB_ARGS_ARG(2, 3));
+	drb_api->mrb_define_method(state, Body, "create_l_shape", body_create_l_shape, MRB_ARGS_ARG(2, 3));
+	drb_api->mrb_define_method(state, Body, "create_j_shape", body_create_j_shape, MRB_ARGS_ARG(2, 3));
+	drb_api->mrb_define_method(state, Body, "create_i_shape", body_create_i_shape, MRB_ARGS_ARG(2, 3));
+	drb_api->mrb_define_method(state, Body, "create_s_shape", body_create_s_shape, MRB_ARGS_ARG(2, 3));
+	drb_api->mrb_define_method(state, Body, "create_z_shape", body_create_z_shape, MRB_ARGS_ARG(2, 3));
 	//TODO: create S and Z shapes...
 	drb_api->mrb_define_method(state, Body, "create_chain_shape", body_create_chain_shape, MRB_ARGS_ARG(2, 2));
 	drb_api->mrb_define_method(state, Body, "position", body_position, MRB_ARGS_NONE());
@@ -1095,15 +3398,20 @@ void drb_register_c_extensions_with_api(mrb_state *state, struct drb_api_t *api)
 	drb_api->mrb_define_method(state, Body, "angle", body_angle, MRB_ARGS_NONE());
 	drb_api->mrb_define_method(state, Body, "angle=", body_set_rotation, MRB_ARGS_REQ(1));
 	drb_api->mrb_define_method(state, Body, "angular_velocity=", body_set_angular_velocity, MRB_ARGS_REQ(1));
-	drb_api->mrb_define_method(state, Body, "rotate", body_rotate, MRB_ARGS_REQ(1));
+	drb_api->mrb_define_method(state, Body, "control", body_control, MRB_ARGS_ARG(2, 2));
+	drb_api->mrb_define_method(state, Body, "release_control", body_release_control, MRB_ARGS_NONE());
 	drb_api->mrb_define_method(state, Body, "apply_force_center", body_apply_force_center, MRB_ARGS_REQ(2));
 	drb_api->mrb_define_method(state, Body, "apply_impulse_center", body_apply_impulse_center, MRB_ARGS_REQ(2));
 	drb_api->mrb_define_method(state, Body, "apply_impulse_for_velocity", body_apply_impulse_for_velocity, MRB_ARGS_REQ(2));
 	drb_api->mrb_define_method(state, Body, "get_info", body_get_info, MRB_ARGS_NONE());
 	drb_api->mrb_define_method(state, Body, "awake?", body_is_awake, MRB_ARGS_NONE());
 	drb_api->mrb_define_method(state, Body, "collided?", body_has_collided, MRB_ARGS_NONE());
+	drb_api->mrb_define_method(state, Body, "settled_frozen?", body_is_settled_frozen, MRB_ARGS_NONE());
+	drb_api->mrb_define_method(state, Body, "in_active_region?", body_in_active_region, MRB_ARGS_NONE());
+	drb_api->mrb_define_method(state, Body, "tag", body_tag, MRB_ARGS_NONE());
 	drb_api->mrb_define_method(state, Body, "destroy", body_destroy, MRB_ARGS_NONE());
-	// TODO: remove old contact mehods which aren't used anymore?
 	drb_api->mrb_define_method(state, Body, "contacts", body_get_contacts, MRB_ARGS_NONE());
+	drb_api->mrb_define_method(state, Body, "connected_bodies", body_get_connected_bodies, MRB_ARGS_NONE());
+	drb_api->mrb_define_method(state, Body, "stack_height", body_get_stack_height, MRB_ARGS_NONE());
 	drb_api->mrb_define_method(state, Body, "sensor_contact_count", body_get_sensor_contact_count, MRB_ARGS_NONE());
 }
@@ -0,0 +1,237 @@
+# Microbenchmark and self-check of the native extension's Ruby-facing methods. Runs once against the real extension, prints one
+# "[ffi_bench]" line per check and per benchmarked method (ns/call and native allocations/call, from World#memory_stats) and quits.
+# Any failed check prints a line containing FAILED, which makes `sh mygame/pre-native.sh --ffi-bench` exit with an error.
+#
+# Run with: ./dragonruby mygame --scenario ffi_bench
+# test/ffi_test.c runs the unit conversion, line clear and create_bodies checks natively, without DragonRuby (pre-native.sh --test).
+class FFIBench
+  ITERATIONS = 10_000
+  STEP_ITERATIONS = 300
+  PIXELS_PER_METER = 32.0 # must match extension.c
+  SQUARE_SIZE = 40
+  GROUND_Y = 80
+  STACK_LEFT = 300
+  STACK_BLOCKS = 7 # O blocks side by side, i.e. two lines of 14 cells
+  BOARD_PIECES = 1000
+  PARTICLE_CAPACITY = 4096 # must match extension.c
+  PUFFS_PER_CELL = 300
+  MATERIALS = [[1.0, 0.9, 0.0], [2.0, 0.5, 0.1]].freeze
+  DT = 1.0 / 60.0
+
+  def initialize(game)
+    @game = game
+    @failures = 0
+  end
+
+  def tick
+    @world = World.new
+    # these settings are global in the extension; the bench wants plain Box2D behaviour
+    @world.freeze_settled(false)
+    @world.damp_jitter(false)
+    @world.clear_active_region
+    @world.puff_particles(0)
+
+    check_unit_conversion
+    check_line_clear
+    check_create_bodies
+    check_search_placements
+    run_benchmarks
+
+    puts "[ffi_bench] #{@failures.zero? ? 'all checks passed' : "#{@failures} checks FAILED"}"
+    $gtk.request_quit
+  end
+
+  def check(name, condition, detail = nil)
+    @failures += 1 unless condition
+    puts "[ffi_bench] check #{name}: #{condition ? 'ok' : "FAILED #{detail}"}"
+  end
+
+  def close?(a, b, epsilon = 0.01)
+    (a - b).abs < epsilon
+  end
+
+  def check_unit_conversion
+    body = @world.create_body('dynamic', 123.0, 456.0, true)
+    body.create_box_shape(SQUARE_SIZE, SQUARE_SIZE, 1.0)
+    pos = body.position
+    meters = body.position_meters
+    check 'position in pixels', close?(pos.x, 123.0) && close?(pos.y, 456.0), pos
+    check 'position_meters', close?(meters.x, 123.0 / PIXELS_PER_METER) && close?(meters.y, 456.0 / PIXELS_PER_METER), meters
+
+    body.angle = 90.0
+    check 'angle in degrees', close?(body.angle, 90.0), body.angle
+
+    shape = body.get_shapes_info.first
+    check 'shape size in pixels', close?(shape.w, SQUARE_SIZE) && close?(shape.h, SQUARE_SIZE), shape
+    body.destroy
+  end
+
+  # a settled row of O blocks: clearing its bottom line has to hit every cell once and leave every block with its top two cells
+  def check_line_clear
+    ground = build_ground
+    blocks = build_stack
+    120.times { @world.step(DT) }
+
+    line_y = GROUND_Y + SQUARE_SIZE / 2
+    stack_right = STACK_LEFT + STACK_BLOCKS * (SQUARE_SIZE * 2 + 1)
+    # enough puffs per cell to fill the particle pool, benchmarked by run_benchmarks
+    @world.puff_particles(PUFFS_PER_CELL)
+    results = @world.scan_lines(STACK_LEFT - 20, stack_right + 20, [line_y], STACK_BLOCKS * 2, 16.0, 1.4 * 48.0)
+    @world.puff_particles(0)
+
+    check 'line cleared cells', results.cleared_points.size == STACK_BLOCKS * 2, results.cleared_points.size
+    check 'line bodies to split', results.bodies_to_split.size == STACK_BLOCKS, results.bodies_to_split.size
+    remaining = results.bodies_to_split.map { |body| body.get_shapes_info }
+    check 'split keeps top cells', remaining.all? { |shapes| shapes.size == 2 && shapes.all? { |s| s.y > 0 } }, remaining.map(&:size)
+    check 'no scratch memory left', @world.memory_stats.categories.scratch.bytes.zero?
+    check 'particle pool filled', @world.update_particles(0.0).size == PARTICLE_CAPACITY * 4
+
+    missed = @world.scan_lines(STACK_LEFT - 20, stack_right + 20, [line_y + SQUARE_SIZE * 3], 2)
+    check 'empty line clears nothing', missed.cleared_points.empty? && missed.bodies_to_split.empty?
+
+    blocks.each(&:destroy)
+    ground.destroy
+  end
+
+  # create_bodies has to give the same bodies as create_body + create_*_shape, in record order and with their tags
+  def check_create_bodies
+    packed = [0, 200, 300, 90, 0, 0, 1, 7,
+              1, 400, 300, 0, 0, 0, 9, 8,  # unknown material
+              1, 600, 300, 0, 0, 0, 2, 9]  # malformed material
+    bodies = @world.create_bodies(packed, SQUARE_SIZE, MATERIALS + [[1.0, 0.9]])
+    body = bodies.first
+    check 'create_bodies leaves nil for bad records', bodies.size == 3 && bodies[1].nil? && bodies[2].nil?, bodies.size
+    check 'create_bodies position and angle', close?(body.position.x, 200) && close?(body.position.y, 300) && close?(body.angle, 90.0),
+          [body.position, body.angle]
+    check 'create_bodies tag', body.tag == 7, body.tag
+    check 'create_bodies t_shape', body.get_shapes_info.size == 2, body.get_shapes_info.size
+    check 'create_bodies rejects partial records', @world.create_bodies([0, 1, 2], SQUARE_SIZE, MATERIALS).nil?
+    body.destroy
+  end
+
+  # a row of O blocks with the last slot open: only an O dropped into the gap completes both lines
+  def check_search_placements
+    ground = build_ground
+    blocks = build_stack
+    blocks.pop.destroy
+    120.times { @world.step(DT) }
+
+    gap_x = STACK_LEFT + (STACK_BLOCKS - 1) * (SQUARE_SIZE * 2 + 1) + SQUARE_SIZE
+    line_ys = [GROUND_Y + SQUARE_SIZE / 2, GROUND_Y + SQUARE_SIZE * 3 / 2]
+    candidates = [1, STACK_LEFT + 200, 0, 1, gap_x, 0, 1, gap_x + 200, 0]
+    results = @world.search_placements(candidates, MATERIALS.first, SQUARE_SIZE, 600, line_ys, STACK_BLOCKS * 2, 1000, 1.0, 3)
+    best = results.first
+    check 'search_placements evaluates all', results.size == 3, results.size
+    check 'search_placements best fills the gap', best && close?(best.x, gap_x) && best.lines == 2, best
+    scores = results.map(&:score)
+    check 'search_placements sorted', scores == scores.sort.reverse, scores
+    stats = @world.placement_stats
+    check 'placement_stats counts the search', stats.candidates == 3 && stats.evaluated == 3, stats
+
+    # the same search in the background, stepping the live world while it runs
+    start = Time.now.to_f
+    started = @world.start_placement_search(candidates, MATERIALS.first, SQUARE_SIZE, 600, line_ys, STACK_BLOCKS * 2, 1000, 1.0, 3)
+    puts "[ffi_bench] start_placement_search returned after #{((Time.now.to_f - start) * 1000).round(2)} ms"
+    background = nil
+    steps = 0
+    while started && background.nil? && steps < 100_000
+      @world.step(DT)
+      background = @world.placement_search_result
+      steps += 1
+    end
+    check 'placement_search_result matches search_placements', background && background.first && close?(background.first.x, best.x), background
+    check 'placement_search_result is collected once', @world.placement_search_result.nil?
+    check 'search_placements leaves live world alone', blocks.all? { |block| block.get_shapes_info.size == 2 }
+    check 'no scratch memory left after search', @world.memory_stats.categories.scratch.bytes.zero?
+
+    blocks.each(&:destroy)
+    ground.destroy
+  end
+
+  # flat records for a board of `count` pieces in a grid well above the ground
+  def packed_board(count)
+    packed = []
+    count.times do |i|
+      packed.push(i % 7, 100 + (i % 25) * SQUARE_SIZE * 5, 2000 + (i / 25) * SQUARE_SIZE * 5, (i % 4) * 90, 0, 0, i % 2, i)
+    end
+    packed
+  end
+
+  def build_ground
+    ground = @world.create_body('static', 0, 0)
+    # right to left, chain shapes are one-sided
+    ground.create_chain_shape([{ x: 1200, y: GROUND_Y }, { x: 80, y: GROUND_Y }], false, 1.0, 0.0)
+    ground
+  end
+
+  def build_stack(rows = 1)
+    blocks = []
+    rows.times do |row|
+      STACK_BLOCKS.times do |i|
+        x = STACK_LEFT + i * (SQUARE_SIZE * 2 + 1) + SQUARE_SIZE
+        y = GROUND_Y + SQUARE_SIZE + row * (SQUARE_SIZE * 2 + 1)
+        body = @world.create_body('dynamic', x, y, true)
+        body.create_box_shape_2x2(SQUARE_SIZE, 1.0, 0.9, 0.0, true)
+        blocks << body
+      end
+    end
+    blocks
+  end
+
+  def native_allocations
+    @world.memory_stats.categories.values.inject(0) { |sum, category| sum + category.allocations }
+  end
+
+  def bench(name, iterations = ITERATIONS)
+    allocations_before = native_allocations
+    start = Time.now.to_f
+    i = 0
+    while i < iterations
+      yield
+      i += 1
+    end
+    elapsed = Time.now.to_f - start
+    allocations = native_allocations - allocations_before
+    ns = (elapsed * 1_000_000_000 / iterations).round
+    puts "[ffi_bench] #{name.ljust(24)} #{ns.to_s.rjust(8)} ns/call #{(allocations / iterations.to_f).round(2).to_s.rjust(6)} native allocs/call"
+  end
+
+  def run_benchmarks
+    ground = build_ground
+    blocks = build_stack(3)
+    body = blocks.first
+    stack_right = STACK_LEFT + STACK_BLOCKS * (SQUARE_SIZE * 2 + 1)
+    ray_y = GROUND_Y + SQUARE_SIZE / 2
+
+    bench('position') { body.position }
+    bench('get_info') { body.get_info }
+    bench('get_shapes_info') { body.get_shapes_info }
+    # min_hits can't be reached, so the ray is evaluated without clearing anything
+    bench('raycast (no clear)') { @world.raycast(STACK_LEFT - 20, ray_y, stack_right + 20, ray_y, 1000, 16.0, 1.4 * 48.0) }
+    bench('create + t_shape + destroy') do
+      piece = @world.create_body('dynamic', 640, 600, true)
+      piece.create_t_shape(SQUARE_SIZE, 1.0, 0.9, 0.0, true)
+      piece.destroy
+    end
+    bench('step (stack of 21)', STEP_ITERATIONS) { @world.step(DT) }
+    # dt 0 keeps the full pool from check_line_clear alive
+    bench("update_particles (#{PARTICLE_CAPACITY})", 1000) { @world.update_particles(0.0) }
+
+    candidates = Array.new(40) { |i| [i % 7, STACK_LEFT + i * 20, (i % 4) * 90] }.flatten
+    line_ys = [ray_y, ray_y + SQUARE_SIZE]
+    bench('search_placements (40)', 20) { @world.search_placements(candidates, MATERIALS.first, SQUARE_SIZE, 600, line_ys, 14, 1000, 1.0) }
+
+    board = packed_board(BOARD_PIECES)
+    bench("create_bodies (#{BOARD_PIECES})", 10) { @world.create_bodies(board, SQUARE_SIZE, MATERIALS).each(&:destroy) }
+    bench("create_body x#{BOARD_PIECES}", 10) do
+      BOARD_PIECES.times do |i|
+        piece = @world.create_body('dynamic', board[i * 8 + 1], board[i * 8 + 2], true)
+        piece.create_t_shape(SQUARE_SIZE, 1.0, 0.9, 0.0, true)
+        piece.destroy
+      end
+    end
+
+    blocks.each(&:destroy)
+    ground.destroy
+  end
+end
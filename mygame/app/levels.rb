@@ -6,6 +6,7 @@ module Levels
   #   - ground width 580 pixels
   #   - ground height 80 pixels
   GROUND_HEIGHT = 80
+  ENDLESS_HEIGHT = 50_000 # wall height of the endless tower level
   LEVEL_DATA = [
     {
       name: 'Bumpy Flats',
@@ -50,10 +51,25 @@ module Levels
         { x: 200, y: 820 }
       ],
       scan_area: { x: 200, y: 100, w: 880, h: 500 }
+    },
+    {
+      # scrolling tower mode: the camera follows the pile and only the bodies around it are simulated (World#active_region)
+      name: 'Endless Tower',
+      endless: true,
+      line_min_blocks: 12,
+      terrain_points: [
+        { x: EDGE_RIGHT, y: ENDLESS_HEIGHT },
+        { x: EDGE_RIGHT, y: GROUND_HEIGHT },
+        { x: EDGE_LEFT, y: GROUND_HEIGHT },
+        { x: EDGE_LEFT, y: ENDLESS_HEIGHT }
+      ],
+      scan_area: { x: EDGE_LEFT, y: GROUND_HEIGHT, w: EDGE_RIGHT - EDGE_LEFT, h: 600 }
     }
     # Add more levels here...
   ].freeze
 
+  ENDLESS_LEVEL_INDEX = LEVEL_DATA.index { |level| level[:endless] }
+
   def self.get(level_index)
     LEVEL_DATA[level_index]
   end
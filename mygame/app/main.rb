@@ -1,4 +1,9 @@
 module PhysicsHelpers
+  # collide tetriminos with their minimal convex proxies instead of one box per cell (cells stay individually clearable)
+  def merge_cells?(args)
+    args.state.physics&.merge_cells != false
+  end
+
   def create_body(args, type, x, y, allow_sleep: true, vx: 0.0, vy: 0.0, angular_velocity: 0.0)
     args.state.world.create_body(type, x, y, allow_sleep, vx, vy, angular_velocity)
   end
@@ -29,7 +34,7 @@ module PhysicsHelpers
     body = create_body(args, 'dynamic', x, y, allow_sleep: allow_sleep)
     friction = args.state.physics&.block_friction || 0.5
     restitution = args.state.physics&.block_restitution || 0.1
-    body.create_t_shape(square_size, density, friction, restitution)
+    body.create_t_shape(square_size, density, friction, restitution, merge_cells?(args))
     body
   end
 
@@ -37,7 +42,7 @@ module PhysicsHelpers
     body = create_body(args, 'dynamic', x, y, allow_sleep: allow_sleep)
     friction = args.state.physics&.block_friction || 0.5
     restitution = args.state.physics&.block_restitution || 0.1
-    body.create_box_shape_2x2(square_size, density, friction, restitution)
+    body.create_box_shape_2x2(square_size, density, friction, restitution, merge_cells?(args))
     body
   end
 
@@ -45,7 +50,7 @@ module PhysicsHelpers
     body = create_body(args, 'dynamic', x, y, allow_sleep: allow_sleep)
     friction = args.state.physics&.block_friction || 0.5
     restitution = args.state.physics&.block_restitution || 0.1
-    body.create_l_shape(square_size, density, friction, restitution)
+    body.create_l_shape(square_size, density, friction, restitution, merge_cells?(args))
     body
   end
 
@@ -53,7 +58,7 @@ module PhysicsHelpers
     body = create_body(args, 'dynamic', x, y, allow_sleep: allow_sleep)
     friction = args.state.physics&.block_friction || 0.5
     restitution = args.state.physics&.block_restitution || 0.1
-    body.create_j_shape(square_size, density, friction, restitution)
+    body.create_j_shape(square_size, density, friction, restitution, merge_cells?(args))
     body
   end
 
@@ -61,7 +66,7 @@ module PhysicsHelpers
     body = create_body(args, 'dynamic', x, y, allow_sleep: allow_sleep)
     friction = args.state.physics&.block_friction || 0.5
     restitution = args.state.physics&.block_restitution || 0.1
-    body.create_i_shape(square_size, density, friction, restitution)
+    body.create_i_shape(square_size, density, friction, restitution, merge_cells?(args))
     body
   end
 
@@ -69,7 +74,7 @@ module PhysicsHelpers
     body = create_body(args, 'dynamic', x, y, allow_sleep: allow_sleep)
     friction = args.state.physics&.block_friction || 0.5
     restitution = args.state.physics&.block_restitution || 0.1
-    body.create_s_shape(square_size, density, friction, restitution)
+    body.create_s_shape(square_size, density, friction, restitution, merge_cells?(args))
     body
   end
 
@@ -77,15 +82,46 @@ module PhysicsHelpers
     body = create_body(args, 'dynamic', x, y, allow_sleep: allow_sleep)
     friction = args.state.physics&.block_friction || 0.5
     restitution = args.state.physics&.block_restitution || 0.1
-    body.create_z_shape(square_size, density, friction, restitution)
+    body.create_z_shape(square_size, density, friction, restitution, merge_cells?(args))
     body
   end
 end
 
+# Draws the packed puff particles from World#update_particles straight through ffi_draw, so no Hash is built per particle
+class PuffRenderer
+  attr_accessor :puffs, :camera_y
+
+  def draw_override(ffi_draw)
+    puffs = @puffs
+    i = 0
+    while i < puffs.length
+      size = puffs[i + 2]
+      half = size / 2
+      ffi_draw.draw_sprite_3(puffs[i] - half, puffs[i + 1] - half - @camera_y, size, size, :pixel, 0, puffs[i + 3], 153, 255, 153,
+                             nil, nil, nil, nil, false, false, 0.5, 0.5, nil, nil, nil, nil)
+      i += 4
+    end
+  end
+end
+
 class Game
   include PhysicsHelpers
-  INITIAL_PHYSICS = { block_friction: 0.9, block_restitution: 0.01, ground_friction: 1.0, ground_restitution: 0.0, gravity: -1.0 }.freeze
-  attr_accessor :active_block
+  INITIAL_PHYSICS = { block_friction: 0.9, block_restitution: 0.01, ground_friction: 1.0, ground_restitution: 0.0, gravity: -1.0,
+                      merge_cells: true }.freeze
+  # native tetromino template names, used by the placement queries (World#can_place)
+  BLOCK_KINDS = { create_t_block: 't', create_o_block: 'o', create_l_block: 'l', create_j_block: 'j',
+                  create_i_block: 'i', create_s_block: 's', create_z_block: 'z' }.freeze
+  # endless mode camera: keeps the top of the settled tower this far above the bottom of the screen
+  CAMERA_TOWER_OFFSET = 360
+  # the active region starts a bit below the screen so bodies don't pop in at the bottom edge
+  ACTIVE_REGION_MARGIN = 80
+  # placement search (hints / auto-player): quarter turns at every half cell of the scan area. The search runs on background threads
+  # while the game goes on, simulating for at most this many ms (a few frames)
+  PLACEMENT_ANGLES = [0, 90, 180, 270].freeze
+  PLACEMENT_BUDGET_MS = 50
+  # density of the falling pieces; the placement search drops its candidates with the same material
+  BLOCK_DENSITY = 1.0
+  attr_accessor :active_block, :fixed_dt
   attr_reader :args, :block_types, :score
 
 
@@ -93,43 +129,33 @@ class Game
   def start_level(level_index)
     level_data = Levels.get(level_index)
     args.state.world = World.new
+    # bodies settled for a few seconds turn static until a line clear below them or a hard impact (m/s) thaws them
+    args.state.world.freeze_settled(true, 4.0, 4.0)
+    # bodies that keep jittering in contact for a second get extra damping, then are put to sleep
+    args.state.world.damp_jitter(true, 1.0)
     args.state.ground = create_body(args, 'static', 0, 0)
     gf = args.state.physics&.ground_friction || 1.0
     gr = args.state.physics&.ground_restitution || 0.0
     # Create ground chain with explicit material properties; ensure native extension is rebuilt when C changes
     args.state.ground.create_chain_shape(level_data.terrain_points, false, gf, gr)
 
+    @camera_y = 0
+    if level_data[:endless]
+      args.state.world.active_region(-ACTIVE_REGION_MARGIN, args.grid.h)
+    else
+      args.state.world.clear_active_region
+    end
 
     # rendering setup
-    unless @static_assets_setup
-      args.render_target(:static_elements).w = args.grid.w
-      args.render_target(:static_elements).h = args.grid.h
-      args.render_target(:static_elements).background_color = [0, 0, 0, 0]
-      args.render_target(:static_elements).sprites << { x: 0, y: 0, w: args.grid.w, h: args.grid.h, path: 'sprites/ignored/paper_texture2.jpg', a: 180 }
-      ground_shapes = args.state.ground.get_shapes_info
-      ground_shapes.each do |shape|
-        p1 = { x: shape[:x1], y: shape[:y1] }
-        p2 = { x: shape[:x2], y: shape[:y2] }
-
-        angle = Math.atan2(p2.y - p1.y, p2.x - p1.x) * (180 / Math::PI)
-        length = Math.sqrt((p2.x - p1.x)**2 + (p2.y - p1.y)**2)
-
-        mx = (p1.x + p2.x) / 2.0
-        my = (p1.y + p2.y) / 2.0
-
-        args.render_target(:static_elements).sprites << {
-          x: mx,
-          y: my,
-          w: length,
-          h: 12, # Height of the texture
-          path: 'sprites/line_test.png',
-          angle: angle,
-          anchor_x: 0.5,
-          anchor_y: 0.5,
-          a: 220
-        }
-      end
+    # terrain sprites are kept per level; the endless level scrolls, so its terrain is drawn every frame instead of from the render target
+    @terrain_sprites = terrain_sprites(args.state.ground)
+    args.render_target(:static_elements).w = args.grid.w
+    args.render_target(:static_elements).h = args.grid.h
+    args.render_target(:static_elements).background_color = [0, 0, 0, 0]
+    args.render_target(:static_elements).sprites << { x: 0, y: 0, w: args.grid.w, h: args.grid.h, path: 'sprites/ignored/paper_texture2.jpg', a: 180 }
+    args.render_target(:static_elements).sprites << @terrain_sprites unless level_data[:endless]
 
+    unless @static_assets_setup
       # create the next piece box render target
       box_w = 220
       box_h = 220
@@ -176,18 +202,19 @@ class Game
 
     args.state.current_level_index = level_index
     args.state.blocks = []
+    @blocks_by_body = {}
     @active_block = nil
+    @placement_pending = false # World.new cancels a running search
+    @control_targets = nil
     args.state.game_state = :playing
 
     @score = 0
     update_high_score
 
     # Frame/cycle counters and timers
-    @spawn_collision_check_frames = 0
     @lock_delay_frames = 8
     @spawn_delay_frames = 45
     @touching_frames = 0
-    @last_spawned_block = nil
     @pending_spawn_frames = 0 # trigger initial spawn via countdown
 
     generate_next_block
@@ -196,7 +223,45 @@ class Game
   def reset_game
     args.state.physics = INITIAL_PHYSICS.dup
     args.state.score = 0
-    start_level(0)
+    start_level(args.state.endless ? Levels::ENDLESS_LEVEL_INDEX : 0)
+  end
+
+  def endless?
+    Levels.get(args.state.current_level_index)[:endless]
+  end
+
+  def terrain_sprites(ground)
+    ground.get_shapes_info.map do |shape|
+      p1 = { x: shape[:x1], y: shape[:y1] }
+      p2 = { x: shape[:x2], y: shape[:y2] }
+
+      angle = Math.atan2(p2.y - p1.y, p2.x - p1.x) * (180 / Math::PI)
+      length = Math.sqrt((p2.x - p1.x)**2 + (p2.y - p1.y)**2)
+
+      mx = (p1.x + p2.x) / 2.0
+      my = (p1.y + p2.y) / 2.0
+
+      {
+        x: mx,
+        y: my,
+        w: length,
+        h: 12, # Height of the texture
+        path: 'sprites/line_test.png',
+        angle: angle,
+        anchor_x: 0.5,
+        anchor_y: 0.5,
+        a: 220
+      }
+    end
+  end
+
+  # endless mode: the camera follows the top of the settled tower and the native active region follows the camera, so only the bodies
+  # around the screen are simulated, scanned and drawn
+  def update_camera
+    tower_top = args.state.world.tower_top || 0
+    target_y = [tower_top - CAMERA_TOWER_OFFSET, 0].max
+    @camera_y += (target_y - @camera_y) * 0.05
+    args.state.world.active_region(@camera_y - ACTIVE_REGION_MARGIN, @camera_y + args.grid.h)
   end
   
   def update_high_score
@@ -268,7 +333,18 @@ class Game
       return
     end
 
+    # M switches between the regular levels and the endless tower
+    if args.inputs.keyboard.key_down.m
+      args.state.endless = !args.state.endless
+      reset_game
+      return
+    end
+
     tune_physics_params
+    toggle_trace if args.inputs.keyboard.key_down.t
+    # H shows where the placement search would put the active piece, O lets it play (for soak tests)
+    @hints = !@hints if args.inputs.keyboard.key_down.h
+    @autoplay = !@autoplay if args.inputs.keyboard.key_down.o
 
     if args.state.game_state == :game_over
       if args.inputs.keyboard.key_down.space
@@ -299,8 +375,65 @@ class Game
                 else
                   0.0
                 end
-      args.state.rot_dir = rot_dir * 50.0
+      args.state.rot_dir = rot_dir * 180.0 # degrees per second
+      args.state.target_angle = nil
+      steer_to_placement if @autoplay && @placement
+    end
+  end
+
+  # candidate drops for the active piece as flat [kind, x, angle] records, see World#search_placements
+  def placement_candidates(kind)
+    level_scan = Levels.get(args.state.current_level_index).scan_area
+    step = @square_size / 2
+    columns = ((level_scan.w - 2 * @square_size) / step).floor + 1
+    candidates = []
+    columns.times do |i|
+      x = level_scan.x + @square_size + i * step
+      PLACEMENT_ANGLES.each { |angle| candidates.push(kind, x, angle) }
     end
+    candidates
+  end
+
+  # starts the native placement search once per piece, in the background; collect_placement sets @placement when it's done
+  def search_placement
+    @placement_block = @active_block
+    @placement = nil
+    return unless @raycast_y_coords
+
+    physics = args.state.physics
+    material = [@active_block.density, physics.block_friction, physics.block_restitution]
+    min_hits = Levels.get(args.state.current_level_index).line_min_blocks || 6
+    @placement_pending = args.state.world.start_placement_search(placement_candidates(@active_block.kind), material, @square_size,
+                                                                 @active_block.body.position.y, @raycast_y_coords, min_hits,
+                                                                 PLACEMENT_BUDGET_MS, 1.0, 1)
+  end
+
+  # picks up the background search once it has finished; @placement is its best result, or nil if the piece has changed meanwhile
+  def collect_placement
+    results = args.state.world.placement_search_result
+    return unless results
+
+    @placement_pending = false
+    @placement = results.first if @placement_block == @active_block
+  end
+
+  # auto-player: moves the active piece over the best placement, holding its angle, and drops it once it's there
+  def steer_to_placement
+    dx = @placement.x - @active_block.body.position.x
+    args.state.horizontal = [[dx / 16.0, -5.0].max, 5.0].min
+    args.state.vertical = dx.abs < @square_size / 4 ? -10.0 : args.state.physics.gravity
+    args.state.rot_dir = 0.0
+    args.state.target_angle = @placement.angle
+  end
+
+  # T starts recording a native trace, pressing it again writes it to trace.json (open in chrome://tracing or ui.perfetto.dev)
+  def toggle_trace
+    @tracing = !@tracing
+    args.state.world.trace(@tracing)
+    return if @tracing
+
+    path = "#{$gtk.get_game_dir}/trace.json"
+    puts "Trace written to #{path}" if args.state.world.trace_flush(path)
   end
 
   def tune_physics_params
@@ -333,16 +466,22 @@ class Game
   end
 
   def update
-    # pre-update: apply impulses / control and update active tetrimino state
+    collect_placement if @placement_pending
+
+    # pre-update: the native controller steers the active tetrimino every sub-step, it only needs new targets when the input changes
     if @active_block
-      hor = args.state.horizontal
-      ver = args.state.vertical
-      @active_block.body.apply_impulse_for_velocity(hor, ver)
-      @active_block.body.rotate(args.state.rot_dir)
+      search_placement if (@hints || @autoplay) && @placement_block != @active_block
+      targets = [args.state.horizontal, args.state.vertical, args.state.rot_dir, args.state.target_angle]
+      if targets != @control_targets
+        @active_block.body.control(*targets)
+        @control_targets = targets
+      end
     end
 
-    # update Box2D world
-    args.state.world.step
+    update_camera if endless?
+
+    # update Box2D world; fixed_dt is only set for scripted runs, normal play steps with the wall-clock delta
+    args.state.world.step(@fixed_dt || 0.0)
 
     # Post-step: handle lock delay for active block collisions, spawn delay etc.
     # TODO: review the post-update steps; control isn't granular enough atm
@@ -350,8 +489,10 @@ class Game
       if @active_block.body.collided?
         @touching_frames += 1
         if @touching_frames >= @lock_delay_frames
+          @active_block.body.release_control
           @active_block.body.apply_impulse_for_velocity(0.0, args.state.physics.gravity)
           @active_block = nil
+          @control_targets = nil
           @touching_frames = 0
           @pending_spawn_frames = @spawn_delay_frames
         end
@@ -364,43 +505,56 @@ class Game
     if @active_block.nil? && @pending_spawn_frames
       @pending_spawn_frames -= 1
       if @pending_spawn_frames <= 0
-        spawn_random_tetrimino
-        @active_block = args.state.blocks.last
-        @last_spawned_block = @active_block
-        @spawn_collision_check_frames = 2
+        @active_block = spawn_random_tetrimino
         @pending_spawn_frames = nil
+        # the spawn area is blocked by the pile -> game over
+        if @active_block.nil?
+          putz "No room to spawn the next block!"
+          args.state.game_state = :game_over
+          update_high_score
+        end
       end
     end
 
-    # post-physics step: check for immediate collision of just spawned block
-    if @spawn_collision_check_frames > 0 && @last_spawned_block
-      if @last_spawned_block.body.collided?
-        putz "Last spawned block immediatelly collided!"
-        args.state.game_state = :game_over
-        update_high_score
-      end
-      @spawn_collision_check_frames -= 1
-      @last_spawned_block = nil if @spawn_collision_check_frames <= 0
-    end
-
 
     # scoring mechanics
     check_for_cleared_lines
 
-    # post-update cleanup
-    # NOTE: this is a separate block instead of combined mainly to track if this condition happens in game
-    args.state.blocks.reject! do |block|
-      empty = block.body.get_shapes_info.empty?
-      puts "Block with no shapes removed!" if empty
-      empty
+    # post-update cleanup, only the blocks in the active region can lose shapes or fall off (disabled ones are buried in the tower)
+    visible_blocks.each do |block|
+      if block.body.get_shapes_info.empty?
+        puts "Block with no shapes removed!"
+        remove_block(block)
+      # NOTE: this could affect scoring as well? Minus points on blocks "lost" ?
+      elsif block.body.position.y < -100
+        remove_block(block)
+      end
     end
-    # NOTE: this could affect scoring as well? Minus points on blocks "lost" ?
-    args.state.blocks.reject! do |block|
-      block.body.position.y < -100 
+  end
+
+  def add_block(block_info)
+    args.state.blocks << block_info
+    @blocks_by_body[block_info.body] = block_info
+  end
+
+  def remove_block(block_info)
+    args.state.blocks.delete(block_info)
+    @blocks_by_body.delete(block_info.body)
+  end
+
+  # the blocks whose bodies overlap the active region as of the last step (all of them outside endless mode); one native call instead
+  # of asking every block ever placed
+  def visible_blocks
+    blocks = []
+    args.state.world.region_bodies.each do |body|
+      block_info = @blocks_by_body[body]
+      blocks << block_info if block_info
     end
+    blocks
   end
 
   def split_body(block_info)
+    args.state.world.trace_begin('split_body')
     original_body = block_info.body
     info = original_body.get_info
     remaining_shapes = original_body.get_shapes_info
@@ -422,13 +576,14 @@ class Game
                                       vx: info.vx, vy: info.vy, angular_velocity: info.angular_velocity)
 
         # Add to game state
-        args.state.blocks << { body: new_body, color: block_info.color }
+        add_block({ body: new_body, color: block_info.color })
       end
     end
 
     # Destroy original body and remove from game state
     original_body.destroy
-    args.state.blocks.delete(block_info)
+    remove_block(block_info)
+    args.state.world.trace_end('split_body')
   end
 
   def count_score destroyed_count
@@ -439,10 +594,10 @@ class Game
     level_data = Levels.get(args.state.current_level_index)
     level_scan = level_data.scan_area
 
-    # Determine vertical scan range dynamically: from terrain bottom to spawn height (top)
+    # Determine vertical scan range dynamically: from terrain bottom (or the bottom of the screen in endless mode) to spawn height (top)
     terrain_bottom = level_data.terrain_points.map { |p| p.y }.min
-    spawn_top = args.grid.h - 100
-    scan_y = terrain_bottom
+    spawn_top = args.grid.h - 100 + @camera_y
+    scan_y = [terrain_bottom, @camera_y].max
     scan_h = [spawn_top - scan_y, 1].max
 
     # Use level-provided x-range
@@ -454,30 +609,18 @@ class Game
     vertical_tolerance = 16.0 # TODO: less magic numbers, use block size or something
     horiztonal_tolerance = 1.4 * 48.0
 
-    @raycast_y_coords = []
-    @cleared_shape_origins = []
+    @raycast_y_coords = Array.new(num_rays) { |i| scan_y + (scan_h / num_rays) * i }
     @all_raycast_hits = []
 
-    total_bodies_to_split = []
-    cleared_shapes_count = 0
-    num_rays.times do |i|
-      ray_y = scan_y + (scan_h / num_rays) * i
-      @raycast_y_coords << ray_y
-      ray_start_x = scan_x
-      ray_end_x = scan_x + scan_w
-
-      raycast_results = args.state.world.raycast(ray_start_x, ray_y, ray_end_x, ray_y, min_hits, vertical_tolerance, horiztonal_tolerance)
-      next if raycast_results.empty?
-
-      cleared_shapes_count += raycast_results.cleared_points.size
-      
-      @cleared_shape_origins.concat raycast_results.cleared_points
-      args.state.score += raycast_results.cleared_points.length
-      total_bodies_to_split.concat raycast_results.bodies_to_split
-
-      if args.state.profile
-        color_index = i % @debug_colors.size
-        @all_raycast_hits << { points: raycast_results.all_hits, color_index: color_index } 
+    # all lines are cleared in one native call, so bodies crossed by several lines only get their mass recomputed once
+    scan_results = args.state.world.scan_lines(scan_x, scan_x + scan_w, @raycast_y_coords, min_hits, vertical_tolerance, horiztonal_tolerance)
+    cleared_shapes_count = scan_results.cleared_points.size
+    args.state.score += cleared_shapes_count
+    total_bodies_to_split = scan_results.bodies_to_split
+
+    if args.state.profile
+      scan_results.all_hits.each_with_index do |hits, i|
+        @all_raycast_hits << { points: hits, color_index: i % @debug_colors.size }
       end
     end
 
@@ -487,10 +630,8 @@ class Game
       args.state.physics.gravity -= (cleared_shapes_count / 10) * 0.1
     end
 
-    total_bodies_to_split.uniq!
-
     total_bodies_to_split.each do |body_to_split|
-      block_info = args.state.blocks.find { |b| b.body == body_to_split }
+      block_info = @blocks_by_body[body_to_split]
       split_body(block_info) if block_info
     end
   end
@@ -503,17 +644,22 @@ class Game
     @next_block_body = send(@next_block_type, args, 0, 0, square_size: @square_size, allow_sleep: true)
   end
 
+  # spawns the next tetrimino at the top of the play area and returns its block info, or nil if the spawn area is blocked
   def spawn_random_tetrimino
     block_type = @next_block_type
     color_name = @next_block_color
-    generate_next_block
 
     spawn_x = args.grid.w / 2
-    spawn_y = args.grid.h - 100
+    spawn_y = args.grid.h - 100 + @camera_y
+
+    return nil unless args.state.world.can_place(BLOCK_KINDS[block_type], spawn_x, spawn_y, 0, @square_size)
 
-    new_block = send(block_type, args, spawn_x, spawn_y, square_size: @square_size, allow_sleep: true)
+    generate_next_block
+    new_block = send(block_type, args, spawn_x, spawn_y, square_size: @square_size, density: BLOCK_DENSITY, allow_sleep: true)
 
-    args.state.blocks << { body: new_block, color: color_name }
+    block_info = { body: new_block, color: color_name, kind: BLOCK_KINDS.keys.index(block_type), density: BLOCK_DENSITY }
+    add_block(block_info)
+    block_info
   end
 
   def render
@@ -521,10 +667,15 @@ class Game
     labels = []
 
     sprites << { x: 0, y: 0, w: args.grid.w, h: args.grid.h, path: :static_elements }
+    cy = @camera_y
+    if endless?
+      @terrain_sprites.each { |terrain| sprites << terrain.merge(y: terrain.y - cy) }
+    end
 
     # NOTE: this is quite heavy atm and could do with a bunch of optimization
-    args.state.blocks.each do |block_info|
+    visible_blocks.each do |block_info|
       body = block_info.body
+
       color_name = block_info.color
       tint = @pastel_colors[color_name]
 
@@ -543,7 +694,7 @@ class Game
         rotated_rel_y = rel_x * Math.sin(body_angle_rad) + rel_y * Math.cos(body_angle_rad)
 
         final_x = body_pos.x + rotated_rel_x
-        final_y = body_pos.y + rotated_rel_y
+        final_y = body_pos.y + rotated_rel_y - cy
 
         extra_size_px = 1 # a tiny bit of extra width and height to the blocks, as the texture has some buffer
         tile_sprite_count = 3
@@ -565,16 +716,21 @@ class Game
       end
     end
 
+    render_landing_ghost(sprites)
+    render_placement_hint(sprites) if @hints
+
     @all_raycast_hits.each do |hit_group|
       color = @debug_colors[hit_group.color_index]
       hit_group.points.each do |p|
-        sprites << { x: p.x, y: p.y, w: 5, h: 5, path: :pixel, r: color[0], g: color[1], b: color[2], a: 200, anchor_x: 0.5, anchor_y: 0.5 }
+        sprites << { x: p.x, y: p.y - cy, w: 5, h: 5, path: :pixel, r: color[0], g: color[1], b: color[2], a: 200, anchor_x: 0.5, anchor_y: 0.5 }
       end
     end
 
-    @cleared_shape_origins.each do |s|
-      sprites << { x: s.x, y: s.y, w: 12, h: 12, path: :pixel, r:153, g:255, b:153, a:255, anchor_x: 0.5, anchor_y: 0.5 }
-    end
+    # line clear puffs are emitted and simulated natively; the packed buffer holds [x, y, size, alpha] per particle
+    @puff_renderer ||= PuffRenderer.new
+    @puff_renderer.puffs = args.state.world.update_particles(args.state.game_state == :playing ? 1.0 / 60.0 : 0.0)
+    @puff_renderer.camera_y = cy
+    sprites << @puff_renderer
 
     labels << { alignment_enum: 0, font: 'fonts/dirty_harold/dirty_harold.ttf', x: 10, y: args.grid.h - 10, r: 20, g: 20, b: 20, size_enum: 4, text: "Score: #{args.state.score}" }
     labels << { alignment_enum: 0, font: 'fonts/dirty_harold/dirty_harold.ttf', x: 10, y: args.grid.h - 40, r: 20, g: 20, b: 20, size_enum: 2, text: "Gravity: #{args.state.physics.gravity.round(2)}" }
@@ -607,13 +763,24 @@ class Game
       labels << { x: 120.from_right, y: args.grid.h - 10, text: "Friction: #{pf}", size_enum: 2, r: 60, g: 60, b: 60, font: 'fonts/dirty_harold/dirty_harold.ttf' }
       labels << { x: 120.from_right, y: args.grid.h - 30, text: "Restitution: #{pr}", size_enum: 2, r: 60, g: 60, b: 60, font: 'fonts/dirty_harold/dirty_harold.ttf' }
       labels << { x: 120.from_right, y: args.grid.h - 50, text: "Gravity: #{pg}", size_enum: 2, r: 60, g: 60, b: 60, font: 'fonts/dirty_harold/dirty_harold.ttf' }
+      labels << { x: 120.from_right, y: args.grid.h - 70, text: "Frozen: #{args.state.world.frozen_count}", size_enum: 2, r: 60, g: 60, b: 60, font: 'fonts/dirty_harold/dirty_harold.ttf' }
+      labels << { x: 120.from_right, y: args.grid.h - 90, text: "Jittering: #{args.state.world.jittering_bodies.size}", size_enum: 2, r: 60, g: 60, b: 60, font: 'fonts/dirty_harold/dirty_harold.ttf' }
+      memory = args.state.world.memory_stats
+      labels << { x: 120.from_right, y: args.grid.h - 110, text: "Memory: #{memory.current / 1024} KB (Box2D #{memory.categories.box2d.bytes / 1024} KB)", size_enum: 2, r: 60, g: 60, b: 60, font: 'fonts/dirty_harold/dirty_harold.ttf' }
+      labels << { x: 120.from_right, y: args.grid.h - 130, text: "Body contexts: #{memory.categories.body_contexts.count}", size_enum: 2, r: 60, g: 60, b: 60, font: 'fonts/dirty_harold/dirty_harold.ttf' }
+
 
+      labels << { x: 120.from_right, y: args.grid.h - 150, text: "Disabled: #{args.state.world.disabled_count}", size_enum: 2, r: 60, g: 60, b: 60, font: 'fonts/dirty_harold/dirty_harold.ttf' }
+      if @hints || @autoplay
+        search = args.state.world.placement_stats
+        labels << { x: 120.from_right, y: args.grid.h - 170, text: "Placements: #{search.evaluated}/#{search.candidates} (#{search.ms.round(1)} ms)", size_enum: 2, r: 60, g: 60, b: 60, font: 'fonts/dirty_harold/dirty_harold.ttf' }
+      end
 
-      level_data = Levels.get(0) # TODO: get current level data
+      level_data = Levels.get(args.state.current_level_index)
       @raycast_y_coords.each do |ray_y|
         args.outputs.lines << {
-          x: level_data.scan_area.x, y: ray_y,
-          x2: level_data.scan_area.x + level_data.scan_area.w, y2: ray_y,
+          x: level_data.scan_area.x, y: ray_y - cy,
+          x2: level_data.scan_area.x + level_data.scan_area.w, y2: ray_y - cy,
           r: 255, g: 100, b: 100, a: 100
         }
       end
@@ -623,6 +790,48 @@ class Game
     args.outputs.labels << labels
   end
 
+  # ghost-piece indicator: the active block's shapes drawn faintly where a straight drop would land them
+  def render_landing_ghost(sprites)
+    return unless @active_block && args.state.game_state == :playing
+
+    body = @active_block.body
+    landing = args.state.world.predict_landing(body)
+    return unless landing
+
+    render_piece_ghost(sprites, body, landing.x, landing.y, landing.angle, @pastel_colors[@active_block.color], 60)
+  end
+
+  # the body's shapes drawn as flat boxes at the given position and angle
+  def render_piece_ghost(sprites, body, x, y, angle, tint, alpha)
+    angle_rad = angle * (Math::PI / 180.0)
+    cos_a = Math.cos(angle_rad)
+    sin_a = Math.sin(angle_rad)
+
+    body.get_shapes_info.each do |shape|
+      sprites << {
+        x: x + shape.x * cos_a - shape.y * sin_a,
+        y: y + shape.x * sin_a + shape.y * cos_a - @camera_y,
+        w: shape.w,
+        h: shape.h,
+        path: :pixel,
+        r: tint[0],
+        g: tint[1],
+        b: tint[2],
+        a: alpha,
+        anchor_x: 0.5,
+        anchor_y: 0.5,
+        angle: angle
+      }
+    end
+  end
+
+  # the active block drawn where the placement search expects it to come to rest
+  def render_placement_hint(sprites)
+    return unless @active_block && @placement && args.state.game_state == :playing
+
+    render_piece_ghost(sprites, @active_block.body, @placement.rest_x, @placement.rest_y, @placement.rest_angle, [40, 160, 40], 90)
+  end
+
   def render_next_block_preview(sprites, labels)
     box_w = 220
     box_h = 220
@@ -675,9 +884,21 @@ def tick(args)
     $game = Game.new(args)
     args.state.game = $game
     $game.setup
+
+    if $gtk.cli_arguments[:scenario] == 'ffi_bench'
+      require 'app/ffi_bench.rb'
+      args.state.scenario = FFIBench.new($game)
+    elsif $gtk.cli_arguments[:scenario]
+      require 'app/scenario.rb'
+      args.state.scenario = Scenario.new($game, ($gtk.cli_arguments[:frames] || Scenario::FRAMES).to_i)
+    end
   end
 
-  args.state.game.tick
+  if args.state.scenario
+    args.state.scenario.tick
+  else
+    args.state.game.tick
+  end
 end
 
 def boot(args)
@@ -0,0 +1,49 @@
+# Scripted, input-free play session with a fixed seed and a fixed time step. Used to train the profile guided optimization build and
+# to compare b2World_Step timings between build configurations (see mygame/pre-native.sh --release and --bench).
+#
+# Run with: ./dragonruby mygame --scenario drops [--frames 3600]
+class Scenario
+  FRAMES = 3600
+  SEED = 1234
+
+  def initialize(game, frames)
+    @game = game
+    @frames = frames
+    @frame = 0
+    @target_x = nil
+    srand(SEED)
+    @game.fixed_dt = 1.0 / 60.0
+    @game.args.state.world.step_profile(true)
+  end
+
+  def tick
+    state = @game.args.state
+    @game.reset_game if state.game_state == :game_over
+
+    # steer the active piece towards a pseudo-random column, rotating it now and then, and drop it fast
+    state.horizontal = 0.0
+    state.vertical = -10.0
+    state.rot_dir = 0.0
+    if @game.active_block
+      scan = Levels.get(state.current_level_index).scan_area
+      @target_x ||= scan.x + 80 + rand(scan.w - 160)
+      dx = (@target_x - @game.active_block.body.position.x) / 40.0
+      dx = 1.0 if dx > 1.0
+      dx = -1.0 if dx < -1.0
+      state.horizontal = dx * 5.0
+      state.rot_dir = 180.0 if (@frame / 30).even?
+    else
+      @target_x = nil
+    end
+
+    @game.update
+    @frame += 1
+    finish if @frame == @frames
+  end
+
+  def finish
+    profile = @game.args.state.world.step_profile
+    puts "[scenario] frames: #{@frames} steps: #{profile.steps} avg step: #{profile.avg_ms.round(4)} ms max step: #{profile.max_ms.round(4)} ms"
+    $gtk.request_quit
+  end
+end
@@ -47,6 +47,7 @@ clang ^
   -fuse-ld=lld ^
   -shared ^
   -fPIC ^
+  -pthread ^
   -isystem "%DRB_ROOT%\include" ^
   -I. ^
   -Imygame ^
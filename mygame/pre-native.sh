@@ -1,63 +1,177 @@
 #!/bin/sh
+# Builds the native extension. Build modes:
+#   (none)      debug flags (-g)
+#   --optimize  -O2
+#   --release   -O3, LTO and -march; the Box2D objects are built once and cached in mygame/native/build
+#   --pgo       --release trained with the scripted scenario (app/scenario.rb); needs llvm-profdata and ./dragonruby
+#   --bench     builds --optimize and --release in turn and prints the scenario step times of both
+#   --ffi-bench builds --optimize and runs app/ffi_bench.rb: self-checks and ns/call of the Ruby-facing methods; fails on a failed check
+#   --test      builds test/ffi_test.c (extension + Box2D against a mock drb_api, no DragonRuby needed) and runs the same checks plus
+#               ns, native allocations and Ruby objects per call; fails on a failed check
 
 OSTYPE=`uname -s`
 if [ "x$OSTYPE" = "xDarwin" ]; then
   PLATFORM=macos
   DLLEXT=dylib
+  LTO_LINK_FLAGS=""
 else
   PLATFORM=linux-amd64
   DLLEXT=so
+  LTO_LINK_FLAGS="-fuse-ld=lld"
 fi
 
 DRB_ROOT=.
 mkdir -p mygame/native/$PLATFORM
+OUTPUT=mygame/native/$PLATFORM/ext.$DLLEXT
+BUILD_DIR=mygame/native/build/$PLATFORM
+INCLUDE_FLAGS="-isystem $DRB_ROOT/include -isystem $DRB_ROOT -Imygame -Imygame/lib/box2d/include"
+SCENARIO_FRAMES=3600
 
-OPTIMIZATION_FLAGS="-g"
-if [ "$1" = "--optimize" ]; then
-  echo "Compiling with optimizations..."
-  OPTIMIZATION_FLAGS="-O2"
+BOX2D_SOURCES="mygame/lib/box2d/src/wheel_joint.c
+mygame/lib/box2d/src/weld_joint.c
+mygame/lib/box2d/src/types.c
+mygame/lib/box2d/src/timer.c
+mygame/lib/box2d/src/table.c
+mygame/lib/box2d/src/solver_set.c
+mygame/lib/box2d/src/solver.c
+mygame/lib/box2d/src/shape.c
+mygame/lib/box2d/src/sensor.c
+mygame/lib/box2d/src/revolute_joint.c
+mygame/lib/box2d/src/prismatic_joint.c
+mygame/lib/box2d/src/physics_world.c
+mygame/lib/box2d/src/mover.c
+mygame/lib/box2d/src/motor_joint.c
+mygame/lib/box2d/src/math_functions.c
+mygame/lib/box2d/src/manifold.c
+mygame/lib/box2d/src/joint.c
+mygame/lib/box2d/src/id_pool.c
+mygame/lib/box2d/src/island.c
+mygame/lib/box2d/src/hull.c
+mygame/lib/box2d/src/geometry.c
+mygame/lib/box2d/src/distance_joint.c
+mygame/lib/box2d/src/dynamic_tree.c
+mygame/lib/box2d/src/distance.c
+mygame/lib/box2d/src/core.c
+mygame/lib/box2d/src/contact_solver.c
+mygame/lib/box2d/src/contact.c
+mygame/lib/box2d/src/constraint_graph.c
+mygame/lib/box2d/src/broad_phase.c
+mygame/lib/box2d/src/body.c
+mygame/lib/box2d/src/bitset.c
+mygame/lib/box2d/src/array.c
+mygame/lib/box2d/src/arena_allocator.c
+mygame/lib/box2d/src/aabb.c"
+
+# Box2D uses SSE2 on x86-64 and NEON on arm64 in every build mode (BOX2D_DISABLE_SIMD would turn that off). The release build targets
+# x86-64-v2 so the shipped library runs on any CPU from the last decade; RELEASE_AVX2=1 builds an AVX2 variant instead (x86-64-v3 and
+# Box2D's BOX2D_AVX2 path), which crashes with an illegal instruction on CPUs without AVX2. RELEASE_MARCH overrides the baseline.
+if [ "x`uname -m`" = "xx86_64" ]; then
+  if [ "x$RELEASE_AVX2" = "x1" ]; then
+    RELEASE_FLAGS="-O3 -DNDEBUG -flto=thin -march=${RELEASE_MARCH:-x86-64-v3} -DBOX2D_AVX2"
+  else
+    RELEASE_FLAGS="-O3 -DNDEBUG -flto=thin -march=${RELEASE_MARCH:-x86-64-v2}"
+  fi
 else
-	echo "Compiling with debug flags..."
+  RELEASE_FLAGS="-O3 -DNDEBUG -flto=thin"
 fi
 
-clang \
-  -isystem $DRB_ROOT/include -isystem $DRB_ROOT -Imygame -Imygame/lib/box2d/include \
-  -fPIC -shared mygame/app/extension.c \
-  mygame/lib/box2d/src/wheel_joint.c \
-mygame/lib/box2d/src/weld_joint.c \
-mygame/lib/box2d/src/types.c \
-mygame/lib/box2d/src/timer.c \
-mygame/lib/box2d/src/table.c \
-mygame/lib/box2d/src/solver_set.c \
-mygame/lib/box2d/src/solver.c \
-mygame/lib/box2d/src/shape.c \
-mygame/lib/box2d/src/sensor.c \
-mygame/lib/box2d/src/revolute_joint.c \
-mygame/lib/box2d/src/prismatic_joint.c \
-mygame/lib/box2d/src/physics_world.c \
-mygame/lib/box2d/src/mover.c \
-mygame/lib/box2d/src/motor_joint.c \
-mygame/lib/box2d/src/math_functions.c \
-mygame/lib/box2d/src/manifold.c \
-mygame/lib/box2d/src/joint.c \
-mygame/lib/box2d/src/id_pool.c \
-mygame/lib/box2d/src/island.c \
-mygame/lib/box2d/src/hull.c \
-mygame/lib/box2d/src/geometry.c \
-mygame/lib/box2d/src/distance_joint.c \
-mygame/lib/box2d/src/dynamic_tree.c \
-mygame/lib/box2d/src/distance.c \
-mygame/lib/box2d/src/core.c \
-mygame/lib/box2d/src/contact_solver.c \
-mygame/lib/box2d/src/contact.c \
-mygame/lib/box2d/src/constraint_graph.c \
-mygame/lib/box2d/src/broad_phase.c \
-mygame/lib/box2d/src/body.c \
-mygame/lib/box2d/src/bitset.c \
-mygame/lib/box2d/src/array.c \
-mygame/lib/box2d/src/arena_allocator.c \
-mygame/lib/box2d/src/aabb.c \
-  $OPTIMIZATION_FLAGS -o mygame/native/$PLATFORM/ext.$DLLEXT
+# Single clang invocation over extension.c and all Box2D sources, as used by the debug and --optimize builds
+build_simple() {
+  clang $INCLUDE_FLAGS -fPIC -shared -pthread mygame/app/extension.c $BOX2D_SOURCES $1 -o $OUTPUT
+}
+
+# Compiles the Box2D sources into $1 with flags $2. Objects are reused until their source (or the optional file $3, e.g. a PGO
+# profile) changes; changing the flags wipes the cache.
+build_box2d_objects() {
+  OBJ_DIR=$1
+  mkdir -p $OBJ_DIR
+  if [ "x`cat $OBJ_DIR/flags 2>/dev/null`" != "x$2" ]; then
+    rm -f $OBJ_DIR/*.o
+    echo "$2" > $OBJ_DIR/flags
+  fi
+
+  for SRC in $BOX2D_SOURCES; do
+    OBJ=$OBJ_DIR/`basename $SRC .c`.o
+    if [ ! -f $OBJ ] || [ $SRC -nt $OBJ ] || { [ -n "$3" ] && [ $3 -nt $OBJ ]; }; then
+      echo "  $SRC"
+      clang $INCLUDE_FLAGS -fPIC -c $SRC $2 -o $OBJ || return 1
+    fi
+  done
+}
+
+# Builds extension.c and links it against the cached Box2D objects in $1 with flags $2 (LTO happens at this link step)
+build_release() {
+  echo "Building Box2D objects ($1)..."
+  build_box2d_objects $1 "$2" "$3" || return 1
+  echo "Linking extension..."
+  clang $INCLUDE_FLAGS -fPIC -shared -pthread mygame/app/extension.c $1/*.o $2 $LTO_LINK_FLAGS -o $OUTPUT
+}
+
+# Runs the scripted scenario against the currently built extension, printing its step time summary line
+run_scenario() {
+  ./dragonruby mygame --scenario drops --frames $SCENARIO_FRAMES | grep "\[scenario\]"
+}
+
+build_pgo() {
+  PGO_DIR=$BUILD_DIR/pgo
+  PROFILE=$PGO_DIR/ext.profdata
+  mkdir -p $PGO_DIR
+  rm -f $PGO_DIR/*.profraw
+
+  echo "PGO 1/3: instrumented build..."
+  build_release $BUILD_DIR/box2d-pgo-generate "$RELEASE_FLAGS -fprofile-instr-generate" || return 1
+
+  echo "PGO 2/3: training with the scripted scenario..."
+  LLVM_PROFILE_FILE="$PGO_DIR/ext-%p.profraw" run_scenario || return 1
+  llvm-profdata merge -output=$PROFILE $PGO_DIR/*.profraw || return 1
+
+  echo "PGO 3/3: optimized build..."
+  build_release $BUILD_DIR/box2d-pgo-use "$RELEASE_FLAGS -fprofile-instr-use=$PROFILE" $PROFILE
+}
+
+case "$1" in
+  --optimize)
+    echo "Compiling with optimizations..."
+    build_simple "-O2"
+    ;;
+  --release)
+    echo "Compiling release build..."
+    build_release $BUILD_DIR/box2d-release "$RELEASE_FLAGS"
+    ;;
+  --pgo)
+    echo "Compiling profile guided release build..."
+    build_pgo
+    ;;
+  --bench)
+    echo "Benchmarking -O2 against the release build ($SCENARIO_FRAMES scenario frames each)..."
+    if build_simple "-O2" && O2_RESULT=`run_scenario` &&
+      build_release $BUILD_DIR/box2d-release "$RELEASE_FLAGS" && RELEASE_RESULT=`run_scenario`; then
+      echo "-O2:     $O2_RESULT"
+      echo "release: $RELEASE_RESULT"
+    else
+      false
+    fi
+    ;;
+  --ffi-bench)
+    echo "Running the FFI benchmark and self-checks..."
+    if build_simple "-O2"; then
+      FFI_BENCH_RESULT=`./dragonruby mygame --scenario ffi_bench | grep "\[ffi_bench\]"`
+      echo "$FFI_BENCH_RESULT"
+      ! echo "$FFI_BENCH_RESULT" | grep -q FAILED
+    else
+      false
+    fi
+    ;;
+  --test)
+    echo "Building and running the native test..."
+    mkdir -p $BUILD_DIR
+    clang $INCLUDE_FLAGS -O2 -pthread mygame/test/ffi_test.c $BOX2D_SOURCES -lm -o $BUILD_DIR/ffi_test && $BUILD_DIR/ffi_test
+    ;;
+  *)
+    echo "Compiling with debug flags..."
+    build_simple "-g"
+    ;;
+esac
 
 if [ $? -ne 0 ]; then
   echo "Compilation failed."
@@ -0,0 +1,646 @@
+// Standalone native test of the extension: extension.c and the Box2D sources are compiled into a plain executable and registered
+// against a mock drb_api_t, so the World / Body methods can be called directly without DragonRuby. Runs the unit conversion, line clear
+// and split checks of app/ffi_bench.rb (plus a few of its own) and times the same calls with the native clock. Prints one "[ffi_test]" line
+// per check and per benchmark (ns/call, native allocations/call from World#memory_stats and mock Ruby objects/call) and exits with 1 if a
+// check failed.
+//
+// Build and run with: sh mygame/pre-native.sh --test
+//
+// The mock mruby is just enough for the extension: floats, strings, symbols and hashes are small heap objects only this file decodes,
+// arrays and data objects are real RArray / RData (RARRAY_LEN, DATA_PTR and mrb_data_init read them inline). Nothing is ever freed, as if
+// the GC never ran.
+#include "../app/extension.c"
+
+#include <stdarg.h>
+
+#define ITERATIONS 10000
+#define STEP_ITERATIONS 300
+#define SQUARE_SIZE 40.0f
+#define GROUND_Y 80.0f
+#define STACK_LEFT 300.0f
+#define STACK_BLOCKS 7 // O blocks side by side, i.e. two lines of 14 cells
+#define DT (1.0f / 60.0f)
+
+// mock objects
+
+typedef struct {
+	struct RBasic basic;
+	mrb_float value;
+} mock_float;
+
+typedef struct {
+	struct RBasic basic;
+	char *chars;
+} mock_string;
+
+typedef struct {
+	struct RBasic basic;
+	mrb_sym sym;
+} mock_symbol;
+
+typedef struct {
+	struct RBasic basic;
+	mrb_value *keys;
+	mrb_value *values;
+	int count;
+	int capacity;
+} mock_hash;
+
+typedef struct {
+	struct RBasic basic;
+	char name[32];
+} mock_class;
+
+typedef struct {
+	struct RClass *klass;
+	const char *name;
+	mrb_func_t func;
+} mock_method;
+
+#define MOCK_MAX_SYMBOLS 256
+#define MOCK_MAX_METHODS 128
+
+static char *symbol_names[MOCK_MAX_SYMBOLS];
+static mrb_value symbol_values[MOCK_MAX_SYMBOLS];
+static int symbol_count = 0;
+static mock_method methods[MOCK_MAX_METHODS];
+static int method_count = 0;
+static int failures = 0;
+static long long object_count = 0;	   // every mock Ruby object
+static long long extension_objects = 0; // the ones created inside extension methods (not the test's arguments), see call
+
+static void *mock_alloc(size_t size, enum mrb_vtype type) {
+	object_count++;
+	struct RBasic *object = calloc(1, size);
+	object->tt = type;
+	return object;
+}
+
+static enum mrb_vtype mock_type(mrb_value value) { return mrb_immediate_p(value) ? MRB_TT_FALSE : mrb_basic_ptr(value)->tt; }
+
+static mrb_value mock_float_value(mrb_state *mrb, mrb_float f) {
+	mock_float *object = mock_alloc(sizeof(mock_float), MRB_TT_FLOAT);
+	object->value = f;
+	return mrb_obj_value(object);
+}
+
+static mrb_value mock_int_value(mrb_state *mrb, mrb_int i) { return mrb_fixnum_value(i); }
+
+static mrb_float mock_to_flo(mrb_state *mrb, mrb_value value) {
+	if (mrb_fixnum_p(value))
+		return (mrb_float)mrb_fixnum(value);
+	if (mock_type(value) == MRB_TT_FLOAT)
+		return ((mock_float *)mrb_basic_ptr(value))->value;
+	printf("[ffi_test] -- WARNING: to_flo on a value that is no number\n");
+	return 0.0;
+}
+
+static mrb_value str(const char *chars) {
+	mock_string *object = mock_alloc(sizeof(mock_string), MRB_TT_STRING);
+	object->chars = strdup(chars);
+	return mrb_obj_value(object);
+}
+
+static const char *mock_str_to_cstr(mrb_state *mrb, mrb_value value) {
+	return mock_type(value) == MRB_TT_STRING ? ((mock_string *)mrb_basic_ptr(value))->chars : "";
+}
+
+// symbols are interned by name, and every symbol has a single value object so hash keys compare by pointer
+static mrb_sym mock_intern_cstr(mrb_state *mrb, const char *name) {
+	for (int i = 0; i < symbol_count; ++i) {
+		if (strcmp(symbol_names[i], name) == 0)
+			return (mrb_sym)(i + 1);
+	}
+	if (symbol_count == MOCK_MAX_SYMBOLS) {
+		printf("[ffi_test] -- ERROR: out of symbols\n");
+		exit(1);
+	}
+	symbol_names[symbol_count] = strdup(name);
+	mock_symbol *object = mock_alloc(sizeof(mock_symbol), MRB_TT_SYMBOL);
+	object->sym = (mrb_sym)(symbol_count + 1);
+	symbol_values[symbol_count] = mrb_obj_value(object);
+	return (mrb_sym)++symbol_count;
+}
+
+static mrb_sym mock_intern_static(mrb_state *mrb, const char *name, size_t length) { return mock_intern_cstr(mrb, name); }
+
+static mrb_value mock_symbol_value(mrb_sym sym) { return symbol_values[sym - 1]; }
+
+static mrb_value sym(const char *name) { return mock_symbol_value(mock_intern_cstr(NULL, name)); }
+
+static mrb_value mock_ary_new_capa(mrb_state *mrb, mrb_int capacity) {
+	struct RArray *ary = mock_alloc(sizeof(struct RArray), MRB_TT_ARRAY);
+	ary->as.heap.aux.capa = capacity > 0 ? capacity : 4;
+	ary->as.heap.ptr = malloc(sizeof(mrb_value) * ary->as.heap.aux.capa);
+	return mrb_obj_value(ary);
+}
+
+static mrb_value mock_ary_new(mrb_state *mrb) { return mock_ary_new_capa(mrb, 4); }
+
+static void mock_ary_push(mrb_state *mrb, mrb_value value, mrb_value item) {
+	struct RArray *ary = (struct RArray *)mrb_basic_ptr(value);
+	if (ary->as.heap.len == ary->as.heap.aux.capa) {
+		ary->as.heap.aux.capa *= 2;
+		ary->as.heap.ptr = realloc(ary->as.heap.ptr, sizeof(mrb_value) * ary->as.heap.aux.capa);
+	}
+	ary->as.heap.ptr[ary->as.heap.len++] = item;
+}
+
+static mrb_value mock_ary_new_from_values(mrb_state *mrb, mrb_int count, const mrb_value *values) {
+	mrb_value ary = mock_ary_new_capa(mrb, count);
+	for (mrb_int i = 0; i < count; ++i) {
+		mock_ary_push(mrb, ary, values[i]);
+	}
+	return ary;
+}
+
+static mrb_value mock_ary_entry(mrb_value value, mrb_int index) {
+	struct RArray *ary = (struct RArray *)mrb_basic_ptr(value);
+	return index >= 0 && index < ary->as.heap.len ? ary->as.heap.ptr[index] : mrb_nil_value();
+}
+
+static mrb_value floats(int count, const float *values) {
+	mrb_value ary = mock_ary_new_capa(NULL, count);
+	for (int i = 0; i < count; ++i) {
+		mock_ary_push(NULL, ary, mock_float_value(NULL, values[i]));
+	}
+	return ary;
+}
+
+static bool mock_same(mrb_value a, mrb_value b) {
+	if (mrb_immediate_p(a) || mrb_immediate_p(b))
+		return mrb_fixnum_p(a) && mrb_fixnum_p(b) && mrb_fixnum(a) == mrb_fixnum(b);
+	return mrb_basic_ptr(a) == mrb_basic_ptr(b);
+}
+
+static mrb_value mock_hash_new(mrb_state *mrb) { return mrb_obj_value(mock_alloc(sizeof(mock_hash), MRB_TT_HASH)); }
+
+static void mock_hash_set(mrb_state *mrb, mrb_value value, mrb_value key, mrb_value item) {
+	mock_hash *hash = (mock_hash *)mrb_basic_ptr(value);
+	for (int i = 0; i < hash->count; ++i) {
+		if (mock_same(hash->keys[i], key)) {
+			hash->values[i] = item;
+			return;
+		}
+	}
+	if (hash->count == hash->capacity) {
+		hash->capacity = hash->capacity ? hash->capacity * 2 : 8;
+		hash->keys = realloc(hash->keys, sizeof(mrb_value) * hash->capacity);
+		hash->values = realloc(hash->values, sizeof(mrb_value) * hash->capacity);
+	}
+	hash->keys[hash->count] = key;
+	hash->values[hash->count++] = item;
+}
+
+static mrb_value mock_hash_get(mrb_state *mrb, mrb_value value, mrb_value key) {
+	mock_hash *hash = (mock_hash *)mrb_basic_ptr(value);
+	for (int i = 0; i < hash->count; ++i) {
+		if (mock_same(hash->keys[i], key))
+			return hash->values[i];
+	}
+	return mrb_nil_value();
+}
+
+// hash[:name], e.g. get(get(stats, "categories"), "scratch")
+static mrb_value get(mrb_value hash, const char *name) {
+	return mock_type(hash) == MRB_TT_HASH ? mock_hash_get(NULL, hash, sym(name)) : mrb_nil_value();
+}
+
+static float get_f(mrb_value hash, const char *name) { return (float)mock_to_flo(NULL, get(hash, name)); }
+
+static void *mock_malloc(mrb_state *mrb, size_t size) { return malloc(size); }
+static void *mock_realloc(mrb_state *mrb, void *p, size_t size) { return realloc(p, size); }
+static void mock_free(mrb_state *mrb, void *p) { free(p); }
+
+static Uint32 mock_get_ticks(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (Uint32)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static struct RClass *mock_class_named(const char *name) {
+	mock_class *klass = mock_alloc(sizeof(mock_class), MRB_TT_OBJECT);
+	snprintf(klass->name, sizeof(klass->name), "%s", name);
+	return (struct RClass *)klass;
+}
+
+static struct RClass *mock_module_get(mrb_state *mrb, const char *name) { return mock_class_named(name); }
+
+static struct RClass *mock_define_module_under(mrb_state *mrb, struct RClass *outer, const char *name) { return mock_class_named(name); }
+
+static struct RClass *mock_define_class_under(mrb_state *mrb, struct RClass *outer, const char *name, struct RClass *super) {
+	return mock_class_named(name);
+}
+
+static void mock_define_method(mrb_state *mrb, struct RClass *klass, const char *name, mrb_func_t func, mrb_aspec aspec) {
+	if (method_count == MOCK_MAX_METHODS) {
+		printf("[ffi_test] -- ERROR: out of methods\n");
+		exit(1);
+	}
+	methods[method_count++] = (mock_method){klass, name, func};
+}
+
+static mrb_value mock_obj_new(mrb_state *mrb, struct RClass *klass, mrb_int argc, const mrb_value *argv) {
+	struct RData *object = mock_alloc(sizeof(struct RData), MRB_TT_DATA);
+	object->c = klass;
+	return mrb_obj_value(object);
+}
+
+// arguments of the method being called, read by mock_get_args
+static const mrb_value *call_argv;
+static int call_argc;
+
+static mrb_int mock_get_args(mrb_state *mrb, const char *format, ...) {
+	va_list ap;
+	va_start(ap, format);
+	int i = 0;
+	bool optional = false;
+	for (const char *c = format; *c; ++c) {
+		if (*c == '|') {
+			optional = true;
+			continue;
+		}
+		if (*c == '!') // nil is passed through as is
+			continue;
+		if (i == call_argc) {
+			if (!optional) {
+				printf("[ffi_test] -- ERROR: missing argument for \"%s\"\n", format);
+				exit(1);
+			}
+			break;
+		}
+		mrb_value arg = call_argv[i++];
+		switch (*c) {
+		case 'f':
+			*va_arg(ap, mrb_float *) = mock_to_flo(mrb, arg);
+			break;
+		case 'i':
+			*va_arg(ap, mrb_int *) = (mrb_int)mock_to_flo(mrb, arg);
+			break;
+		case 'b':
+			*va_arg(ap, mrb_bool *) = mrb_test(arg);
+			break;
+		case 'z':
+			*va_arg(ap, const char **) = mock_str_to_cstr(mrb, arg);
+			break;
+		default: // A, S, o
+			*va_arg(ap, mrb_value *) = arg;
+			break;
+		}
+	}
+	va_end(ap);
+	return i;
+}
+
+static mrb_state *mrb;
+
+// self.name(args...), looked up among the methods the extension registered for self's class
+static mrb_value call(mrb_value self, const char *name, int argc, ...) {
+	mrb_value argv[16];
+	va_list ap;
+	va_start(ap, argc);
+	for (int i = 0; i < argc; ++i) {
+		argv[i] = va_arg(ap, mrb_value);
+	}
+	va_end(ap);
+
+	struct RClass *klass = mrb_basic_ptr(self)->c;
+	for (int i = 0; i < method_count; ++i) {
+		if (methods[i].klass == klass && strcmp(methods[i].name, name) == 0) {
+			call_argv = argv;
+			call_argc = argc;
+			long long objects_before = object_count;
+			mrb_value result = methods[i].func(mrb, self);
+			extension_objects += object_count - objects_before;
+			return result;
+		}
+	}
+	printf("[ffi_test] -- ERROR: no method %s on %s\n", name, ((mock_class *)klass)->name);
+	exit(1);
+}
+
+static struct RClass *registered_class(const char *name) {
+	for (int i = 0; i < method_count; ++i) {
+		if (strcmp(((mock_class *)methods[i].klass)->name, name) == 0)
+			return methods[i].klass;
+	}
+	return NULL;
+}
+
+static mrb_value f(mrb_float value) { return mock_float_value(NULL, value); }
+static mrb_value i(mrb_int value) { return mrb_fixnum_value(value); }
+static mrb_value b(bool value) { return mrb_bool_value(value); }
+
+static mrb_int len(mrb_value ary) { return mock_type(ary) == MRB_TT_ARRAY ? RARRAY_LEN(ary) : -1; }
+
+// checks and benchmarks
+
+static void check(const char *name, bool condition) {
+	failures += !condition;
+	printf("[ffi_test] check %s: %s\n", name, condition ? "ok" : "FAILED");
+}
+
+static bool close_to(float a, float b) { return fabsf(a - b) < 0.01f; }
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static mrb_value world;
+
+// allocations made through the extension's tracked allocator (Box2D included) since startup, summed over the memory_stats categories
+static long long native_allocations(void) {
+	mock_hash *categories = (mock_hash *)mrb_basic_ptr(get(call(world, "memory_stats", 0), "categories"));
+	long long total = 0;
+	for (int n = 0; n < categories->count; ++n) {
+		total += mrb_fixnum(get(categories->values[n], "allocations"));
+	}
+	return total;
+}
+
+static void report(const char *name, uint64_t elapsed_ns, long long allocations, long long objects, int iterations) {
+	printf("[ffi_test] %-28s %10.0f ns/call %8.2f native allocs/call %8.2f ruby objects/call\n", name, (double)elapsed_ns / iterations,
+		   (double)allocations / iterations, (double)objects / iterations);
+}
+
+// the allocation counts are read outside of the timed loop; memory_stats' own hashes are left out of the object count
+#define BENCH(name, iterations, statement)                                                                                                 \
+	do {                                                                                                                                   \
+		long long allocations_before = native_allocations();                                                                               \
+		long long objects_before = extension_objects;                                                                                      \
+		uint64_t start_ns = now_ns();                                                                                                      \
+		for (int iteration = 0; iteration < (iterations); ++iteration) {                                                                   \
+			statement;                                                                                                                     \
+		}                                                                                                                                  \
+		uint64_t elapsed_ns = now_ns() - start_ns;                                                                                         \
+		long long objects = extension_objects - objects_before;                                                                            \
+		report(name, elapsed_ns, native_allocations() - allocations_before, objects, iterations);                                          \
+	} while (0)
+
+static mrb_value build_ground(void) {
+	mrb_value ground = call(world, "create_body", 3, str("static"), f(0), f(0));
+	// right to left, chain shapes are one-sided
+	mrb_value points = mock_ary_new(mrb);
+	float xs[2] = {1200, 80};
+	for (int p = 0; p < 2; ++p) {
+		mrb_value point = mock_hash_new(mrb);
+		mock_hash_set(mrb, point, sym("x"), f(xs[p]));
+		mock_hash_set(mrb, point, sym("y"), f(GROUND_Y));
+		mock_ary_push(mrb, points, point);
+	}
+	call(ground, "create_chain_shape", 4, points, b(false), f(1.0), f(0.0));
+	return ground;
+}
+
+static void build_stack(int rows, mrb_value *blocks) {
+	for (int row = 0; row < rows; ++row) {
+		for (int n = 0; n < STACK_BLOCKS; ++n) {
+			float x = STACK_LEFT + n * (SQUARE_SIZE * 2 + 1) + SQUARE_SIZE;
+			float y = GROUND_Y + SQUARE_SIZE + row * (SQUARE_SIZE * 2 + 1);
+			mrb_value body = call(world, "create_body", 4, str("dynamic"), f(x), f(y), b(true));
+			call(body, "create_box_shape_2x2", 5, f(SQUARE_SIZE), f(1.0), f(0.9), f(0.0), b(true));
+			blocks[row * STACK_BLOCKS + n] = body;
+		}
+	}
+}
+
+static void destroy_all(mrb_value *bodies, int count) {
+	for (int n = 0; n < count; ++n) {
+		call(bodies[n], "destroy", 0);
+	}
+}
+
+static bool no_scratch_memory(void) {
+	return mrb_fixnum(get(get(get(call(world, "memory_stats", 0), "categories"), "scratch"), "bytes")) == 0;
+}
+
+static void check_unit_conversion(void) {
+	mrb_value body = call(world, "create_body", 4, str("dynamic"), f(123.0), f(456.0), b(true));
+	call(body, "create_box_shape", 3, f(SQUARE_SIZE), f(SQUARE_SIZE), f(1.0));
+	mrb_value pos = call(body, "position", 0);
+	mrb_value meters = call(body, "position_meters", 0);
+	check("position in pixels", close_to(get_f(pos, "x"), 123.0f) && close_to(get_f(pos, "y"), 456.0f));
+	check("position_meters",
+		  close_to(get_f(meters, "x"), 123.0f / PIXELS_PER_METER) && close_to(get_f(meters, "y"), 456.0f / PIXELS_PER_METER));
+
+	call(body, "angle=", 1, f(90.0));
+	check("angle in degrees", close_to((float)mock_to_flo(mrb, call(body, "angle", 0)), 90.0f));
+
+	mrb_value shape = mock_ary_entry(call(body, "get_shapes_info", 0), 0);
+	check("shape size in pixels", close_to(get_f(shape, "w"), SQUARE_SIZE) && close_to(get_f(shape, "h"), SQUARE_SIZE));
+	call(body, "destroy", 0);
+}
+
+// a settled row of O blocks: clearing its bottom line has to hit every cell once and leave every block with its top two cells
+static void check_line_clear(void) {
+	mrb_value ground = build_ground();
+	mrb_value blocks[STACK_BLOCKS];
+	build_stack(1, blocks);
+	for (int n = 0; n < 120; ++n) {
+		call(world, "step", 1, f(DT));
+	}
+
+	float line_y = GROUND_Y + SQUARE_SIZE / 2;
+	float stack_right = STACK_LEFT + STACK_BLOCKS * (SQUARE_SIZE * 2 + 1);
+	mrb_value results = call(world, "scan_lines", 6, f(STACK_LEFT - 20), f(stack_right + 20), floats(1, &line_y), i(STACK_BLOCKS * 2),
+							 f(16.0), f(1.4 * 48.0));
+	mrb_value to_split = get(results, "bodies_to_split");
+	check("line cleared cells", len(get(results, "cleared_points")) == STACK_BLOCKS * 2);
+	check("line bodies to split", len(to_split) == STACK_BLOCKS);
+
+	bool split_keeps_top = len(to_split) > 0;
+	for (mrb_int n = 0; n < len(to_split); ++n) {
+		mrb_value shapes = call(mock_ary_entry(to_split, n), "get_shapes_info", 0);
+		split_keeps_top = split_keeps_top && len(shapes) == 2;
+		for (mrb_int s = 0; s < len(shapes); ++s) {
+			split_keeps_top = split_keeps_top && get_f(mock_ary_entry(shapes, s), "y") > 0.0f;
+		}
+	}
+	check("split keeps top cells", split_keeps_top);
+	check("no scratch memory left", no_scratch_memory());
+
+	float missed_y = line_y + SQUARE_SIZE * 3;
+	mrb_value missed = call(world, "scan_lines", 4, f(STACK_LEFT - 20), f(stack_right + 20), floats(1, &missed_y), i(2));
+	check("empty line clears nothing", len(get(missed, "cleared_points")) == 0 && len(get(missed, "bodies_to_split")) == 0);
+
+	destroy_all(blocks, STACK_BLOCKS);
+	call(ground, "destroy", 0);
+}
+
+// kind, material and tag are integers; a tag above 2^24 has to survive. Bad records leave nil so the result lines up with the records.
+static void check_create_bodies(void) {
+	mrb_value packed = mock_ary_new(mrb);
+	mrb_value records[24] = {i(0), f(200), f(300), f(90), f(0), f(0), i(1), i(16777217), // 2^24 + 1
+							 i(1), f(400), f(300), f(0),  f(0), f(0), i(9), i(8),		  // unknown material
+							 i(1), f(600), f(300), f(0),  f(0), f(0), i(2), i(9)};		  // malformed material
+	for (int n = 0; n < 24; ++n) {
+		mock_ary_push(mrb, packed, records[n]);
+	}
+	mrb_value materials = mock_ary_new(mrb);
+	float material[3] = {1.0f, 0.9f, 0.0f};
+	mock_ary_push(mrb, materials, floats(3, material));
+	mock_ary_push(mrb, materials, floats(3, material));
+	mock_ary_push(mrb, materials, floats(2, material));
+
+	mrb_value bodies = call(world, "create_bodies", 3, packed, f(SQUARE_SIZE), materials);
+	check("create_bodies leaves nil for bad records",
+		  len(bodies) == 3 && mrb_nil_p(mock_ary_entry(bodies, 1)) && mrb_nil_p(mock_ary_entry(bodies, 2)));
+	if (len(bodies) == 3) {
+		mrb_value body = mock_ary_entry(bodies, 0);
+		mrb_value pos = call(body, "position", 0);
+		check("create_bodies position", close_to(get_f(pos, "x"), 200.0f) && close_to(get_f(pos, "y"), 300.0f));
+		check("create_bodies tag", mrb_fixnum(call(body, "tag", 0)) == 16777217);
+		call(body, "destroy", 0);
+	}
+}
+
+// two settled rows of O blocks, frozen: Box2D has no contacts between static bodies, the contact queries still have to see the pile
+static void check_frozen_contacts(void) {
+	mrb_value ground = build_ground();
+	mrb_value blocks[STACK_BLOCKS * 2];
+	build_stack(2, blocks);
+	call(world, "freeze_settled", 3, b(true), f(0.5), f(3.0));
+	for (int n = 0; n < 240; ++n) {
+		call(world, "step", 1, f(DT));
+	}
+
+	check("stack frozen", mrb_fixnum(call(world, "frozen_count", 0)) == STACK_BLOCKS * 2);
+	check("frozen pile connected to the ground", len(call(ground, "connected_bodies", 0)) == STACK_BLOCKS * 2);
+	check("frozen block connected to its pile", len(call(blocks[STACK_BLOCKS], "connected_bodies", 0)) == STACK_BLOCKS * 2);
+	// the bottom middle block rests on the ground and carries the block above it
+	check("frozen block contacts", len(call(blocks[STACK_BLOCKS / 2], "contacts", 0)) >= 2);
+	check("frozen stack height", close_to(roundf((float)mock_to_flo(mrb, call(ground, "stack_height", 0)) / SQUARE_SIZE), 4.0f));
+
+	call(world, "freeze_settled", 1, b(false));
+	destroy_all(blocks, STACK_BLOCKS * 2);
+	call(ground, "destroy", 0);
+}
+
+// a bottom line of six O blocks and two split remnants (plain boxes without a tetromino kind): a piece dropped on top completes it only if
+// the search counts the remnants' cells
+static void check_placement_counts_remnants(void) {
+	mrb_value ground = build_ground();
+	mrb_value bodies[STACK_BLOCKS + 1];
+	build_stack(1, bodies);
+	call(bodies[STACK_BLOCKS - 1], "destroy", 0);
+	for (int n = 0; n < 2; ++n) {
+		float x = STACK_LEFT + (STACK_BLOCKS - 1) * (SQUARE_SIZE * 2 + 1) + SQUARE_SIZE / 2 + n * (SQUARE_SIZE + 1);
+		bodies[STACK_BLOCKS - 1 + n] = call(world, "create_body", 4, str("dynamic"), f(x), f(GROUND_Y + SQUARE_SIZE / 2), b(true));
+		call(bodies[STACK_BLOCKS - 1 + n], "create_box_shape", 5, f(SQUARE_SIZE), f(SQUARE_SIZE), f(1.0), f(0.9), f(0.0));
+	}
+	for (int n = 0; n < 120; ++n) {
+		call(world, "step", 1, f(DT));
+	}
+
+	mrb_value candidates = mock_ary_new(mrb);
+	mock_ary_push(mrb, candidates, i(TETROMINO_O));
+	mock_ary_push(mrb, candidates, f(STACK_LEFT + SQUARE_SIZE));
+	mock_ary_push(mrb, candidates, f(0));
+	float line_y = GROUND_Y + SQUARE_SIZE / 2;
+	float material[3] = {1.0f, 0.9f, 0.0f};
+	mrb_value results = call(world, "search_placements", 9, candidates, floats(3, material), f(SQUARE_SIZE), f(600), floats(1, &line_y),
+							 i(STACK_BLOCKS * 2), f(1000), f(0.5), i(1));
+	check("placement counts remnant cells", len(results) == 1 && mrb_fixnum(get(mock_ary_entry(results, 0), "lines")) == 1);
+
+	destroy_all(bodies, STACK_BLOCKS + 1);
+	call(ground, "destroy", 0);
+}
+
+static void run_benchmarks(void) {
+	mrb_value ground = build_ground();
+	mrb_value blocks[STACK_BLOCKS * 3];
+	build_stack(3, blocks);
+	mrb_value body = blocks[0];
+	float stack_right = STACK_LEFT + STACK_BLOCKS * (SQUARE_SIZE * 2 + 1);
+	float ray_y = GROUND_Y + SQUARE_SIZE / 2;
+
+	BENCH("position", ITERATIONS, call(body, "position", 0));
+	BENCH("get_info", ITERATIONS, call(body, "get_info", 0));
+	BENCH("get_shapes_info", ITERATIONS, call(body, "get_shapes_info", 0));
+	// min_hits can't be reached, so the ray is evaluated without clearing anything
+	BENCH("raycast (no clear)", ITERATIONS,
+		  call(world, "raycast", 7, f(STACK_LEFT - 20), f(ray_y), f(stack_right + 20), f(ray_y), i(1000), f(16.0), f(1.4 * 48.0)));
+	BENCH("create + t_shape + destroy", ITERATIONS, {
+		mrb_value piece = call(world, "create_body", 4, str("dynamic"), f(640), f(600), b(true));
+		call(piece, "create_t_shape", 5, f(SQUARE_SIZE), f(1.0), f(0.9), f(0.0), b(true));
+		call(piece, "destroy", 0);
+	});
+	BENCH("step (stack of 21)", STEP_ITERATIONS, call(world, "step", 1, f(DT)));
+
+	mrb_value candidates = mock_ary_new(mrb);
+	for (int n = 0; n < 40; ++n) {
+		mock_ary_push(mrb, candidates, i(n % 7));
+		mock_ary_push(mrb, candidates, f(STACK_LEFT + n * 20));
+		mock_ary_push(mrb, candidates, f((n % 4) * 90));
+	}
+	float line_ys[2] = {ray_y, ray_y + SQUARE_SIZE};
+	float material[3] = {1.0f, 0.9f, 0.0f};
+	BENCH("search_placements (40)", 20,
+		  call(world, "search_placements", 8, candidates, floats(3, material), f(SQUARE_SIZE), f(600), floats(2, line_ys), i(14), f(1000),
+			   f(1.0)));
+
+	destroy_all(blocks, STACK_BLOCKS * 3);
+	call(ground, "destroy", 0);
+}
+
+int main(void) {
+	struct drb_api_t api = {0};
+	api.mrb_malloc = mock_malloc;
+	api.mrb_realloc = mock_realloc;
+	api.mrb_free = mock_free;
+	api.mrb_get_args = mock_get_args;
+	api.mrb_module_get = mock_module_get;
+	api.mrb_define_module_under = mock_define_module_under;
+	api.mrb_define_class_under = mock_define_class_under;
+	api.mrb_define_method = mock_define_method;
+	api.mrb_obj_new = mock_obj_new;
+#ifdef mrb_intern_lit // a macro over mrb_intern_static in mruby
+	api.mrb_intern_static = mock_intern_static;
+#else
+	api.mrb_intern_lit = mock_intern_cstr;
+#endif
+	api.mrb_intern_cstr = mock_intern_cstr;
+	api.mrb_symbol_value = mock_symbol_value;
+	api.mrb_ary_new = mock_ary_new;
+	api.mrb_ary_new_capa = mock_ary_new_capa;
+	api.mrb_ary_new_from_values = mock_ary_new_from_values;
+	api.mrb_ary_push = mock_ary_push;
+	api.mrb_ary_entry = mock_ary_entry;
+	api.mrb_hash_new = mock_hash_new;
+	api.mrb_hash_set = mock_hash_set;
+	api.mrb_hash_get = mock_hash_get;
+	api.mrb_float_value = mock_float_value;
+	api.drb_float_value = mock_float_value;
+	api.mrb_int_value = mock_int_value;
+	api.mrb_to_flo = mock_to_flo;
+	api.mrb_str_to_cstr = mock_str_to_cstr;
+	api.SDL_GetTicks = mock_get_ticks;
+
+	mrb = calloc(1, sizeof(mrb_state));
+	mrb->object_class = mock_class_named("Object");
+	drb_register_c_extensions_with_api(mrb, &api);
+
+	world = mock_obj_new(mrb, registered_class("World"), 0, NULL);
+	call(world, "initialize", 0);
+	// these settings are global in the extension; the test wants plain Box2D behaviour
+	call(world, "freeze_settled", 1, b(false));
+	call(world, "damp_jitter", 1, b(false));
+	call(world, "clear_active_region", 0);
+	call(world, "puff_particles", 1, i(0));
+
+	check_unit_conversion();
+	check_line_clear();
+	check_create_bodies();
+	check_frozen_contacts();
+	check_placement_counts_remnants();
+	run_benchmarks();
+
+	if (failures == 0) {
+		printf("[ffi_test] all checks passed\n");
+	} else {
+		printf("[ffi_test] %d checks FAILED\n", failures);
+	}
+	return failures == 0 ? 0 : 1;
+}